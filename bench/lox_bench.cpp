@@ -0,0 +1,271 @@
+// Benchmark runner: runs every workload a number of times, each run in a
+// fresh child process, and prints the median and 95th percentile wall time,
+// the allocations made and the peak RSS of each as JSON.
+//
+//   lox_bench [--engine=tree|vm] [--runs=N] [workload.lox | directory]...
+//
+// With no workloads given it runs bench/workloads/. Output is printed to
+// /dev/null, so the time spent printing is still measured.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Arena.h"
+#include "Interpreter.h"
+#include "Lox.h"
+#include "Optimizer.h"
+#include "Parser.h"
+#include "Resolver.h"
+#include "Scanner.h"
+#include "SourceFile.h"
+#include "Timing.h"
+#include "VM.h"
+
+namespace
+{
+    // Counted by the replacement operator new below. Reset in the child
+    // just before the workload runs.
+    std::size_t allocationCount = 0;
+    std::size_t allocatedBytes = 0;
+}
+
+void* operator new(std::size_t size)
+{
+    allocationCount++;
+    allocatedBytes += size;
+    if (void* memory = std::malloc(size != 0 ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    enum class Engine
+    {
+        TREE,
+        VM
+    };
+
+    // What a child reports back through its pipe.
+    struct Sample
+    {
+        double milliseconds;
+        std::size_t allocations;
+        std::size_t bytes;
+        int status;
+    };
+
+    struct Result
+    {
+        std::string name;
+        std::vector<double> times;
+        Sample last{};
+        long peakRssKB = 0;
+        int status = 0;
+    };
+
+    // The whole pipeline main.cpp runs, minus the REPL. Returns the exit
+    // status lox would use.
+    int runWorkload(const std::string& path, Engine engine, Sample& sample)
+    {
+        Lox::SourceFile source;
+        if (!source.open(path))
+            return 66;
+
+        std::ofstream out("/dev/null");
+        allocationCount = 0;
+        allocatedBytes = 0;
+        Clock::time_point start = Clock::now();
+
+        Lox::Scanner scanner(source.text());
+        Lox::Arena arena;
+        Lox::Parser parser(scanner.scanTokens(), arena);
+        std::vector<Lox::Stmt*> statements = parser.parse();
+        if (!Lox::Lox::HadError)
+        {
+            Lox::Resolver resolver;
+            resolver.resolve(statements);
+        }
+        if (Lox::Lox::HadError)
+            return 65;
+        Lox::Optimizer(arena).optimize(statements);
+
+        if (engine == Engine::VM)
+        {
+            Lox::VM vm(out);
+            vm.setOutputBuffering(Lox::OutputBuffering::BLOCK);
+            vm.interpret(statements);
+        }
+        else
+        {
+            Lox::Interpreter interpreter(out);
+            interpreter.setOutputBuffering(Lox::OutputBuffering::BLOCK);
+            interpreter.interpret(statements);
+        }
+
+        sample.milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        sample.allocations = allocationCount;
+        sample.bytes = allocatedBytes;
+        return Lox::Lox::HadRuntimeError ? 70 : 0;
+    }
+
+    // Forks so every run starts from a clean heap and gets its own peak RSS.
+    bool runOnce(const std::string& path, Engine engine, Result& result)
+    {
+        int fds[2];
+        if (pipe(fds) != 0)
+            return false;
+
+        pid_t pid = fork();
+        if (pid < 0)
+            return false;
+        if (pid == 0)
+        {
+            close(fds[0]);
+            Sample sample{};
+            sample.status = runWorkload(path, engine, sample);
+            ssize_t written = write(fds[1], &sample, sizeof(sample));
+            // Skip tearing the heap down; it isn't part of the measurement.
+            _exit(written == sizeof(sample) ? 0 : 1);
+        }
+
+        close(fds[1]);
+        Sample sample{};
+        ssize_t received = read(fds[0], &sample, sizeof(sample));
+        close(fds[0]);
+
+        int status = 0;
+        struct rusage usage{};
+        wait4(pid, &status, 0, &usage);
+        if (received != sizeof(sample) || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            return false;
+
+        result.times.push_back(sample.milliseconds);
+        result.last = sample;
+        result.status = sample.status;
+#ifdef __APPLE__
+        long rssKB = usage.ru_maxrss / 1024;
+#else
+        long rssKB = usage.ru_maxrss;
+#endif
+        result.peakRssKB = std::max(result.peakRssKB, rssKB);
+        return true;
+    }
+
+    std::string jsonString(const std::string& text)
+    {
+        std::string quoted = "\"";
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                quoted += '\\';
+            quoted += c;
+        }
+        return quoted + "\"";
+    }
+}
+
+int main(int args, char* argv[])
+{
+    Engine engine = Engine::TREE;
+    int runs = 10;
+    std::vector<std::filesystem::path> inputs;
+    for (int i = 1; i < args; i++)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--engine=tree")
+            engine = Engine::TREE;
+        else if (arg == "--engine=vm")
+            engine = Engine::VM;
+        else if (arg.rfind("--runs=", 0) == 0)
+            runs = std::max(1, std::atoi(arg.c_str() + 7));
+        else if (arg.rfind("--", 0) != 0)
+            inputs.emplace_back(arg);
+        else
+        {
+            fmt::print(stderr, "usage: lox_bench [--engine=tree|vm] [--runs=N] [workload.lox | directory]...\n");
+            return 1;
+        }
+    }
+    if (inputs.empty())
+        inputs.emplace_back(LOX_BENCH_WORKLOADS);
+
+    std::vector<std::filesystem::path> workloads;
+    for (const auto& input : inputs)
+    {
+        if (std::filesystem::is_directory(input))
+        {
+            std::vector<std::filesystem::path> found;
+            for (const auto& entry : std::filesystem::directory_iterator(input))
+                if (entry.path().extension() == ".lox")
+                    found.push_back(entry.path());
+            std::sort(found.begin(), found.end());
+            workloads.insert(workloads.end(), found.begin(), found.end());
+        }
+        else
+        {
+            workloads.push_back(input);
+        }
+    }
+
+    bool failed = false;
+    std::vector<Result> results;
+    for (const auto& workload : workloads)
+    {
+        Result& result = results.emplace_back();
+        result.name = workload.stem().string();
+        fmt::print(stderr, "{} ", result.name);
+        for (int run = 0; run < runs; run++)
+        {
+            if (!runOnce(workload.string(), engine, result))
+            {
+                result.status = -1;
+                break;
+            }
+            fmt::print(stderr, ".");
+        }
+        fmt::print(stderr, "\n");
+        failed = failed || result.status != 0;
+    }
+
+    fmt::print("{{\n  \"engine\": \"{}\",\n  \"runs\": {},\n  \"workloads\": [", engine == Engine::VM ? "vm" : "tree", runs);
+    for (std::size_t i = 0; i < results.size(); i++)
+    {
+        Result& result = results[i];
+        fmt::print("{}\n    {{\"name\": {}, \"status\": {}", i == 0 ? "" : ",", jsonString(result.name), result.status);
+        if (!result.times.empty())
+        {
+            std::sort(result.times.begin(), result.times.end());
+            fmt::print(", \"median_ms\": {:.3f}, \"p95_ms\": {:.3f}, \"allocations\": {}, \"allocated_bytes\": {}, \"peak_rss_kb\": {}",
+                Lox::percentile(result.times, 50), Lox::percentile(result.times, 95),
+                result.last.allocations, result.last.bytes, result.peakRssKB);
+        }
+        fmt::print("}}");
+    }
+    fmt::print("\n  ]\n}}\n");
+    return failed ? 1 : 0;
+}
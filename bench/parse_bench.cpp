@@ -0,0 +1,127 @@
+// Parse throughput benchmark: scans and parses a large synthetic script (or
+// the file given on the command line) a number of times and reports the
+// median time and throughput of each phase. Nothing is resolved or run.
+//
+//   lox_parse_bench [--size=MB] [--rounds=N] [script]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "Arena.h"
+#include "Lox.h"
+#include "Parser.h"
+#include "Scanner.h"
+#include "SourceFile.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // A mix of the declarations real scripts are made of, repeated with
+    // fresh names until the source reaches the requested size.
+    std::string generate(std::size_t bytes)
+    {
+        std::string source;
+        source.reserve(bytes + 1024);
+        for (int i = 0; source.size() < bytes; i++)
+        {
+            source += fmt::format(
+                "// Block {0}: a class, a function, a loop and some data.\n"
+                "class Point{0} < Base {{\n"
+                "  init(x, y) {{ this.x = x; this.y = y; }}\n"
+                "  length() {{ return this.x * this.x + this.y * this.y; }}\n"
+                "  moved(dx, dy) {{ return Point{0}(this.x + dx, this.y - dy); }}\n"
+                "}}\n"
+                "fun step{0}(a, b, c) {{\n"
+                "  var total = 0;\n"
+                "  for (var i = 0; i < a; i = i + 1) {{\n"
+                "    if (i == b or !(i > c and i <= a)) total = total + i / 2;\n"
+                "    else total = total - (i * 3.25 + -b);\n"
+                "  }}\n"
+                "  while (total >= 100) total = total - 100;\n"
+                "  return total;\n"
+                "}}\n"
+                "var row{0} = step{0}({0}, {0}.5, \"label {0}\") + Point{0}(1, 2).moved(3, 4).length();\n"
+                "print row{0} != nil;\n",
+                i);
+        }
+        return source;
+    }
+
+    double seconds(Clock::duration duration)
+    {
+        return std::chrono::duration<double>(duration).count();
+    }
+
+    double median(std::vector<double> values)
+    {
+        std::sort(values.begin(), values.end());
+        return values[values.size() / 2];
+    }
+}
+
+int main(int args, char* argv[])
+{
+    double sizeMB = 16;
+    int rounds = 10;
+    const char* script = nullptr;
+    for (int i = 1; i < args; i++)
+    {
+        const std::string arg = argv[i];
+        if (arg.rfind("--size=", 0) == 0)
+            sizeMB = std::atof(arg.c_str() + 7);
+        else if (arg.rfind("--rounds=", 0) == 0)
+            rounds = std::max(1, std::atoi(arg.c_str() + 9));
+        else if (script == nullptr && arg.rfind("--", 0) != 0)
+            script = argv[i];
+        else
+        {
+            fmt::print("usage: lox_parse_bench [--size=MB] [--rounds=N] [script]\n");
+            return 1;
+        }
+    }
+
+    Lox::SourceFile source(script == nullptr ? generate(static_cast<std::size_t>(sizeMB * 1024 * 1024)) : std::string());
+    if (script != nullptr && !source.open(script))
+    {
+        fmt::print("Failed to open {}\n", script);
+        return 1;
+    }
+
+    std::vector<double> scanTimes;
+    std::vector<double> parseTimes;
+    std::size_t tokenCount = 0;
+    std::size_t statementCount = 0;
+    for (int round = 0; round < rounds; round++)
+    {
+        Clock::time_point start = Clock::now();
+        Lox::Scanner scanner(source.text());
+        std::vector<Lox::Token> tokens = scanner.scanTokens();
+        Clock::time_point scanned = Clock::now();
+        tokenCount = tokens.size();
+
+        Lox::Arena arena;
+        Lox::Parser parser(std::move(tokens), arena);
+        std::vector<Lox::Stmt*> statements = parser.parse();
+        Clock::time_point parsed = Clock::now();
+
+        if (Lox::Lox::HadError)
+            return 2;
+        scanTimes.push_back(seconds(scanned - start));
+        parseTimes.push_back(seconds(parsed - scanned));
+        statementCount = statements.size();
+    }
+
+    double megabytes = source.text().size() / (1024.0 * 1024.0);
+    double scan = median(scanTimes);
+    double parse = median(parseTimes);
+    fmt::print("source: {:.1f} MB, {} tokens, {} statements, {} rounds\n", megabytes, tokenCount, statementCount, rounds);
+    fmt::print("scan:   {:8.2f} ms  {:7.1f} MB/s  {:6.2f} M tokens/s\n", scan * 1e3, megabytes / scan, tokenCount / scan / 1e6);
+    fmt::print("parse:  {:8.2f} ms  {:7.1f} MB/s  {:6.2f} M tokens/s\n", parse * 1e3, megabytes / parse, tokenCount / parse / 1e6);
+    return 0;
+}
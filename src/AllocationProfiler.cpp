@@ -0,0 +1,110 @@
+#include "AllocationProfiler.h"
+
+#include <algorithm>
+
+#include <fmt/core.h>
+
+namespace Lox
+{
+    bool Object::profilingAllocations = false;
+
+    std::vector<int> AllocationProfiler::lines;
+    std::map<std::pair<int, ObjectType>, AllocationProfiler::Site> AllocationProfiler::sites;
+    std::unordered_map<const Object*, std::size_t> AllocationProfiler::live;
+    std::size_t AllocationProfiler::liveBytes = 0;
+    std::size_t AllocationProfiler::peakBytes = 0;
+
+    namespace
+    {
+        const char* kindName(ObjectType type)
+        {
+            switch (type)
+            {
+                case ObjectType::STRING: return "string";
+                case ObjectType::FUNCTION: return "function";
+                case ObjectType::CLASS: return "class";
+                case ObjectType::INSTANCE: return "instance";
+                case ObjectType::VM_FUNCTION: return "vm function";
+                case ObjectType::VM_NATIVE: return "vm native";
+                case ObjectType::VM_CLOSURE: return "vm closure";
+                case ObjectType::VM_UPVALUE: return "vm upvalue";
+                case ObjectType::VM_CLASS: return "vm class";
+                case ObjectType::VM_INSTANCE: return "vm instance";
+                case ObjectType::VM_BOUND_METHOD: return "vm bound method";
+                case ObjectType::ENVIRONMENT: return "environment";
+            }
+            return "object";
+        }
+    }
+
+    void Object::profileAllocation(std::size_t size)
+    {
+        if (objectType == ObjectType::STRING)
+        {
+            const std::string& chars = static_cast<const LoxString*>(this)->chars;
+            const char* data = chars.data();
+            const char* self = reinterpret_cast<const char*>(this);
+            if (data < self || data >= self + size)
+                size += chars.capacity() + 1;
+        }
+        profiled = true;
+        AllocationProfiler::allocated(this, size);
+    }
+
+    void Object::profileRelease()
+    {
+        AllocationProfiler::released(this);
+    }
+
+    void AllocationProfiler::enable()
+    {
+        Object::profilingAllocations = true;
+        // Line 0 collects what is created outside any statement.
+        lines.push_back(0);
+    }
+
+    void AllocationProfiler::enterStatement(int line)
+    {
+        lines.push_back(line != 0 ? line : lines.back());
+    }
+
+    void AllocationProfiler::allocated(const Object* object, std::size_t bytes)
+    {
+        Site& site = sites[{lines.back(), object->getObjectType()}];
+        site.count++;
+        site.bytes += bytes;
+
+        live[object] = bytes;
+        liveBytes += bytes;
+        peakBytes = std::max(peakBytes, liveBytes);
+    }
+
+    void AllocationProfiler::released(const Object* object)
+    {
+        if (!isEnabled())
+            return;
+        auto it = live.find(object);
+        liveBytes -= it->second;
+        live.erase(it);
+    }
+
+    void AllocationProfiler::printReport(std::FILE* file)
+    {
+        std::vector<std::pair<std::pair<int, ObjectType>, Site>> sorted(sites.begin(), sites.end());
+        std::stable_sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+            return a.second.bytes > b.second.bytes;
+        });
+
+        std::size_t count = 0;
+        std::size_t bytes = 0;
+        fmt::print(file, "[alloc] {:>8} {:<16} {:>12} {:>14}\n", "line", "kind", "objects", "bytes");
+        for (const auto& [key, site] : sorted)
+        {
+            fmt::print(file, "[alloc] {:>8} {:<16} {:>12} {:>14}\n", key.first, kindName(key.second), site.count, site.bytes);
+            count += site.count;
+            bytes += site.bytes;
+        }
+        fmt::print(file, "[alloc] total: {} objects, {} bytes\n", count, bytes);
+        fmt::print(file, "[alloc] peak live: {} bytes\n", peakBytes);
+    }
+}
@@ -0,0 +1,32 @@
+#include "Arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace Lox
+{
+    Arena::~Arena()
+    {
+        for (auto it = destructors.rbegin(); it != destructors.rend(); ++it)
+            it->destroy(it->object);
+    }
+
+    void* Arena::allocate(std::size_t size, std::size_t alignment)
+    {
+        auto address = reinterpret_cast<std::uintptr_t>(cursor);
+        std::size_t padding = (alignment - address % alignment) % alignment;
+        if (cursor == nullptr || padding + size > static_cast<std::size_t>(end - cursor))
+        {
+            // Blocks come from new[] and so are aligned for any node type.
+            std::size_t blockSize = std::max(BLOCK_SIZE, size);
+            blocks.emplace_back(new std::byte[blockSize]);
+            cursor = blocks.back().get();
+            end = cursor + blockSize;
+            padding = 0;
+        }
+
+        void* memory = cursor + padding;
+        cursor += padding + size;
+        return memory;
+    }
+}
@@ -9,7 +9,7 @@ namespace Lox {
   {
     return paranthesise(expr.op.lexeme, {expr.left.get(), expr.right.get()});
   }
-  std::any AstPrinter::visit_literal_expr(std::shared_ptr<Literal> expr)
+  std::any AstPrinter::visit_literal_expr(Literal* expr)
   {
     std::stringstream stream("");
     // Fix std::any conversion errors here
@@ -1,17 +1,19 @@
 #include "Callable.h"
 
 #include "Interpreter.h"
+#include "LoxInstance.h"
+#include "RunStats.h"
 #include "Stmt/Stmt.h"
 
 #include <cassert>
 
 namespace Lox
 {
-    LoxFunction::LoxFunction(int arity, FuncType f) : arity(arity), f(f), declaration(nullptr)
+    LoxFunction::LoxFunction(int arity, FuncType f) : Callable(ObjectType::FUNCTION), arity(arity), f(f), declaration(nullptr)
     {}
 
-    LoxFunction::LoxFunction(std::shared_ptr<Function> declaration, std::shared_ptr<Environment> closure, bool isInitializer) : 
-    declaration(std::move(declaration)), closure(std::move(closure)), isInitializer(isInitializer)
+    LoxFunction::LoxFunction(Function* declaration, Ref<Environment> closure, bool isInitializer) : 
+    Callable(ObjectType::FUNCTION), declaration(std::move(declaration)), closure(std::move(closure)), isInitializer(isInitializer)
     {
     }
 /*
@@ -19,47 +21,68 @@ namespace Lox
     :
         arity(other.arity), f(other.f), declaration(other.declaration),
         // This line right here is causing all of the issues
-        closure(std::make_shared<Environment>(*other.closure))
+        closure(makeRef<Environment>(*other.closure))
     {}
 */
-    std::shared_ptr<LoxFunction> LoxFunction::bind(std::shared_ptr<LoxInstance> instance)
+    Ref<LoxFunction> LoxFunction::bind(const Ref<LoxInstance>& instance)
     {
-        std::shared_ptr<Environment> environment = std::make_shared<Environment>(closure);
-        environment->define("this", instance);
-        return std::make_shared<LoxFunction>(declaration, environment, isInitializer);
+        Ref<LoxFunction> method = makeRef<LoxFunction>(declaration, closure, isInitializer);
+        RunStats::current.boundMethods++;
+        method->receiver = instance;
+        return method;
     }
 
-    std::any LoxFunction::call(Interpreter& interpreter, const std::vector<std::any>& arguments)
+    Value LoxFunction::call(Interpreter& interpreter, const std::vector<Value>& arguments)
     {
         if (!declaration) 
         {
+            RunStats::current.calls++;
             return f(interpreter, arguments);
         }
+        return callMethod(interpreter, receiver, arguments);
+    }
+
+    Value LoxFunction::callMethod(Interpreter& interpreter, const Value& receiver, const std::vector<Value>& arguments)
+    {
+        assert(declaration);
+        RunStats::current.calls++;
 
         const auto& params = declaration->getParams();
         assert(params.size() == arguments.size());
 
         // There is something wrong with this line
-        auto env = std::make_shared<Environment>(closure);
+        auto env = makeRef<Environment>(closure);
         //auto env = closure;
+        if (!receiver.isNil())
+        {
+            env->define("this", receiver);
+        }
         for(std::size_t i = 0u; i < params.size(); ++i)
         {
             env->define(params.at(i).lexeme, arguments.at(i));
         }
 
-        try {
-            interpreter.executeBlock(declaration->getBody(), env);
-        } catch(const ReturnException& v)
-        {
-            if (isInitializer)
-                return closure->getAt(0, "this");
-            return v.getValue();
-        }
+        Interpreter::CallGuard guard(interpreter, declaration);
+        ExecStatus status = interpreter.executeBlock(declaration->getBody(), env);
 
         if (isInitializer) 
-            return closure->getAt(0, "this");
-        return std::any{};
+            return receiver;
+        if (status == ExecStatus::RETURN)
+            return interpreter.takeReturnValue();
+        return Value{};
     }
+    void LoxFunction::trace(Tracer& tracer) const
+    {
+        tracer.visit(closure);
+        tracer.visit(receiver);
+    }
+
+    void LoxFunction::clearReferences()
+    {
+        closure = nullptr;
+        receiver = Value{};
+    }
+
     int LoxFunction::getArity()
     {
         if (declaration)
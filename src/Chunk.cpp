@@ -0,0 +1,21 @@
+#include "Chunk.h"
+
+namespace Lox
+{
+    void Chunk::write(std::uint8_t byte, int line)
+    {
+        code.push_back(byte);
+        lines.push_back(line);
+    }
+
+    void Chunk::write(OpCode op, int line)
+    {
+        write(static_cast<std::uint8_t>(op), line);
+    }
+
+    int Chunk::addConstant(const Value& value)
+    {
+        constants.push_back(value);
+        return static_cast<int>(constants.size()) - 1;
+    }
+}
@@ -0,0 +1,601 @@
+#include "Compiler.h"
+
+#include "Lox.h"
+#include "VM.h"
+
+#include <cstdint>
+#include <limits>
+
+namespace Lox
+{
+    Compiler::Compiler(VM& vm)
+        : vm(vm)
+    {}
+
+    Ref<ObjFunction> Compiler::compile(const std::vector<Stmt*>& statements)
+    {
+        FunctionState state(nullptr, makeRef<ObjFunction>(), TYPE_SCRIPT);
+        state.locals.push_back(Local{"", 0, false});
+        current = &state;
+        hadError = false;
+
+        for (const auto& statement : statements)
+        {
+            compile(statement);
+        }
+        emitReturn();
+
+        current = nullptr;
+        if (hadError)
+            return nullptr;
+        return state.function;
+    }
+
+    void Compiler::compile(Stmt* stmt)
+    {
+        stmt->accept(*this);
+    }
+
+    void Compiler::compile(Expr* expr)
+    {
+        expr->accept(*this);
+    }
+
+    std::any Compiler::visit_block_stmt(Block* stmt)
+    {
+        beginScope();
+        for (const auto& statement : stmt->stmt)
+        {
+            compile(statement);
+        }
+        endScope();
+        return {};
+    }
+
+    std::any Compiler::visit_class_stmt(Class* stmt)
+    {
+        line = stmt->name.getLine();
+        int nameConstant = identifierConstant(stmt->name.lexeme);
+        if (current->scopeDepth > 0)
+            declareLocal(stmt->name);
+
+        emit(OpCode::CLASS);
+        emitShort(nameConstant);
+        if (current->scopeDepth == 0)
+            defineVariable(stmt->name);
+
+        ClassState classState{currentClass, false};
+        currentClass = &classState;
+
+        if (stmt->superclass != nullptr)
+        {
+            compile(stmt->superclass);
+
+            // The superclass stays on the stack as the hidden local "super"
+            // that methods close over.
+            beginScope();
+            current->locals.push_back(Local{"super", current->scopeDepth, false});
+
+            namedVariable(stmt->name.lexeme, false);
+            line = stmt->superclass->name.getLine();
+            emit(OpCode::INHERIT);
+            classState.hasSuperclass = true;
+        }
+
+        namedVariable(stmt->name.lexeme, false);
+        for (const auto& method : stmt->methods)
+        {
+            FunctionType type = method->name.lexeme == "init" ? TYPE_INITIALIZER : TYPE_METHOD;
+            function(method, type);
+            emit(OpCode::METHOD);
+            emitShort(identifierConstant(method->name.lexeme));
+        }
+        emit(OpCode::POP);
+
+        if (classState.hasSuperclass)
+            endScope();
+
+        currentClass = classState.enclosing;
+        return {};
+    }
+
+    std::any Compiler::visit_expression_stmt(Expression* stmt)
+    {
+        compile(stmt->expr);
+        emit(OpCode::POP);
+        return {};
+    }
+
+    std::any Compiler::visit_function_stmt(Function* stmt)
+    {
+        // A local function is declared before its body so it can call itself.
+        if (current->scopeDepth > 0)
+            declareLocal(stmt->name);
+        function(stmt, TYPE_FUNCTION);
+        if (current->scopeDepth == 0)
+            defineVariable(stmt->name);
+        return {};
+    }
+
+    std::any Compiler::visit_if_stmt(If* stmt)
+    {
+        compile(stmt->condition);
+
+        int thenJump = emitJump(OpCode::JUMP_IF_FALSE);
+        emit(OpCode::POP);
+        compile(stmt->thenBranch);
+
+        int elseJump = emitJump(OpCode::JUMP);
+        patchJump(thenJump);
+        emit(OpCode::POP);
+
+        if (stmt->elseBranch != nullptr)
+            compile(stmt->elseBranch);
+        patchJump(elseJump);
+        return {};
+    }
+
+    std::any Compiler::visit_print_stmt(Print* stmt)
+    {
+        compile(stmt->expr);
+        emit(OpCode::PRINT);
+        return {};
+    }
+
+    std::any Compiler::visit_return_stmt(Return* stmt)
+    {
+        line = stmt->keyword.getLine();
+        if (stmt->value == nullptr)
+        {
+            emitReturn();
+        }
+        else
+        {
+            compile(stmt->value);
+            emit(OpCode::RETURN);
+        }
+        return {};
+    }
+
+    std::any Compiler::visit_var_stmt(Var* stmt)
+    {
+        line = stmt->name.getLine();
+        if (stmt->initializer != nullptr)
+            compile(stmt->initializer);
+        else
+            emit(OpCode::NIL);
+
+        // The initializer's value is left on the stack and becomes the local.
+        defineVariable(stmt->name);
+        return {};
+    }
+
+    std::any Compiler::visit_while_stmt(While* stmt)
+    {
+        int loopStart = static_cast<int>(currentChunk().code.size());
+        compile(stmt->condition);
+
+        int exitJump = emitJump(OpCode::JUMP_IF_FALSE);
+        emit(OpCode::POP);
+        compile(stmt->body);
+        emitLoop(loopStart);
+
+        patchJump(exitJump);
+        emit(OpCode::POP);
+        return {};
+    }
+
+    std::any Compiler::visit_assign_expr(Assign* expr)
+    {
+        compile(expr->value);
+        line = expr->name.getLine();
+        namedVariable(expr->name.lexeme, true);
+        return {};
+    }
+
+    std::any Compiler::visit_literal_expr(Literal* expr)
+    {
+        const Value& literal = expr->getLiteral();
+        if (literal.isNil())
+            emit(OpCode::NIL);
+        else if (literal.isBool())
+            emit(literal.asBool() ? OpCode::TRUE : OpCode::FALSE);
+        else
+            emitConstant(literal);
+        return {};
+    }
+
+    std::any Compiler::visit_logical_expr(Logical* expr)
+    {
+        compile(expr->left);
+
+        if (expr->op.getType() == TokenType::OR)
+        {
+            int elseJump = emitJump(OpCode::JUMP_IF_FALSE);
+            int endJump = emitJump(OpCode::JUMP);
+
+            patchJump(elseJump);
+            emit(OpCode::POP);
+            compile(expr->right);
+            patchJump(endJump);
+        }
+        else
+        {
+            int endJump = emitJump(OpCode::JUMP_IF_FALSE);
+            emit(OpCode::POP);
+            compile(expr->right);
+            patchJump(endJump);
+        }
+        return {};
+    }
+
+    std::any Compiler::visit_set_expr(Set* expr)
+    {
+        compile(expr->object);
+        compile(expr->value);
+        line = expr->name.getLine();
+        emit(OpCode::SET_PROPERTY);
+        emitShort(identifierConstant(expr->name.lexeme));
+        return {};
+    }
+
+    std::any Compiler::visit_super_expr(Super* expr)
+    {
+        line = expr->keyword.getLine();
+        namedVariable("this", false);
+        namedVariable("super", false);
+        emit(OpCode::GET_SUPER);
+        emitShort(identifierConstant(expr->method.lexeme));
+        return {};
+    }
+
+    std::any Compiler::visit_this_expr(This* expr)
+    {
+        line = expr->keyword.getLine();
+        namedVariable("this", false);
+        return {};
+    }
+
+    std::any Compiler::visit_grouping_expr(Grouping* expr)
+    {
+        compile(expr->expr);
+        return {};
+    }
+
+    std::any Compiler::visit_unary_expr(Unary* expr)
+    {
+        compile(expr->right);
+        line = expr->op.getLine();
+
+        switch (expr->op.getType())
+        {
+            case TokenType::MINUS: emit(OpCode::NEGATE); break;
+            case TokenType::BANG: emit(OpCode::NOT); break;
+            default: break;
+        }
+        return {};
+    }
+
+    std::any Compiler::visit_variable_expr(Variable* expr)
+    {
+        line = expr->name.getLine();
+        namedVariable(expr->name.lexeme, false);
+        return {};
+    }
+
+    std::any Compiler::visit_binary_expr(Binary* expr)
+    {
+        compile(expr->left);
+        compile(expr->right);
+        line = expr->op.getLine();
+
+        switch (expr->op.getType())
+        {
+            case TokenType::BANG_EQUAL: emit(OpCode::NOT_EQUAL); break;
+            case TokenType::EQUAL_EQUAL: emit(OpCode::EQUAL); break;
+            case TokenType::GREATER: emit(OpCode::GREATER); break;
+            case TokenType::GREATER_EQUAL: emit(OpCode::GREATER_EQUAL); break;
+            case TokenType::LESS: emit(OpCode::LESS); break;
+            case TokenType::LESS_EQUAL: emit(OpCode::LESS_EQUAL); break;
+            case TokenType::PLUS: emit(OpCode::ADD); break;
+            case TokenType::MINUS: emit(OpCode::SUBTRACT); break;
+            case TokenType::STAR: emit(OpCode::MULTIPLY); break;
+            case TokenType::SLASH: emit(OpCode::DIVIDE); break;
+            default: break;
+        }
+        return {};
+    }
+
+    std::any Compiler::visit_call_expr(Call* expr)
+    {
+        const auto argCount = static_cast<std::uint8_t>(expr->arguments.size());
+
+        // obj.method(...) and super.method(...) skip creating a bound method.
+        if (const auto* get = dynamic_cast<Get*>(expr->callee); get)
+        {
+            compile(get->object);
+            for (const auto& argument : expr->arguments)
+                compile(argument);
+            line = expr->paren.getLine();
+            emit(OpCode::INVOKE);
+            emitShort(identifierConstant(get->name.lexeme));
+            emit(argCount);
+            return {};
+        }
+        if (const auto* super = dynamic_cast<Super*>(expr->callee); super)
+        {
+            line = super->keyword.getLine();
+            namedVariable("this", false);
+            for (const auto& argument : expr->arguments)
+                compile(argument);
+            namedVariable("super", false);
+            line = expr->paren.getLine();
+            emit(OpCode::SUPER_INVOKE);
+            emitShort(identifierConstant(super->method.lexeme));
+            emit(argCount);
+            return {};
+        }
+
+        compile(expr->callee);
+        for (const auto& argument : expr->arguments)
+            compile(argument);
+        line = expr->paren.getLine();
+        emit(OpCode::CALL);
+        emit(argCount);
+        return {};
+    }
+
+    std::any Compiler::visit_get_expr(Get* expr)
+    {
+        compile(expr->object);
+        line = expr->name.getLine();
+        emit(OpCode::GET_PROPERTY);
+        emitShort(identifierConstant(expr->name.lexeme));
+        return {};
+    }
+
+    void Compiler::function(Function* declaration, FunctionType type)
+    {
+        line = declaration->name.getLine();
+        FunctionState state(current, makeRef<ObjFunction>(), type);
+        state.function->name = vm.intern(declaration->name.lexeme);
+        state.function->arity = static_cast<int>(declaration->params.size());
+        // Slot zero holds the receiver for methods and the callee otherwise.
+        state.locals.push_back(Local{type == TYPE_FUNCTION ? "" : "this", 0, false});
+        current = &state;
+
+        beginScope();
+        for (const auto& param : declaration->params)
+        {
+            declareLocal(param);
+        }
+        for (const auto& statement : declaration->body)
+        {
+            compile(statement);
+        }
+        emitReturn();
+
+        current = state.enclosing;
+        state.function->upvalueCount = static_cast<int>(state.upvalues.size());
+
+        emit(OpCode::CLOSURE);
+        emitShort(makeConstant(state.function));
+        for (const auto& upvalue : state.upvalues)
+        {
+            emit(static_cast<std::uint8_t>(upvalue.isLocal ? 1 : 0));
+            emit(upvalue.index);
+        }
+    }
+
+    void Compiler::beginScope()
+    {
+        current->scopeDepth++;
+    }
+
+    void Compiler::endScope()
+    {
+        current->scopeDepth--;
+
+        auto& locals = current->locals;
+        while (!locals.empty() && locals.back().depth > current->scopeDepth)
+        {
+            emit(locals.back().isCaptured ? OpCode::CLOSE_UPVALUE : OpCode::POP);
+            locals.pop_back();
+        }
+    }
+
+    void Compiler::declareLocal(const Token& name)
+    {
+        if (current->locals.size() > std::numeric_limits<std::uint8_t>::max())
+        {
+            line = name.getLine();
+            error("Too many local variables in function.");
+            return;
+        }
+        current->locals.push_back(Local{name.lexeme, current->scopeDepth, false});
+    }
+
+    void Compiler::defineVariable(const Token& name)
+    {
+        if (current->scopeDepth > 0)
+        {
+            declareLocal(name);
+            return;
+        }
+
+        emit(OpCode::DEFINE_GLOBAL);
+        emitShort(vm.globalSlot(name.lexeme));
+    }
+
+    void Compiler::namedVariable(std::string_view name, bool assign)
+    {
+        int arg = resolveLocal(*current, name);
+        if (arg != -1)
+        {
+            emit(assign ? OpCode::SET_LOCAL : OpCode::GET_LOCAL);
+            emit(static_cast<std::uint8_t>(arg));
+            return;
+        }
+
+        arg = resolveUpvalue(*current, name);
+        if (arg != -1)
+        {
+            emit(assign ? OpCode::SET_UPVALUE : OpCode::GET_UPVALUE);
+            emit(static_cast<std::uint8_t>(arg));
+            return;
+        }
+
+        emit(assign ? OpCode::SET_GLOBAL : OpCode::GET_GLOBAL);
+        emitShort(vm.globalSlot(name));
+    }
+
+    int Compiler::resolveLocal(FunctionState& state, std::string_view name)
+    {
+        for (int i = static_cast<int>(state.locals.size()) - 1; i >= 0; i--)
+        {
+            if (state.locals[i].name == name)
+                return i;
+        }
+        return -1;
+    }
+
+    int Compiler::resolveUpvalue(FunctionState& state, std::string_view name)
+    {
+        if (state.enclosing == nullptr)
+            return -1;
+
+        int local = resolveLocal(*state.enclosing, name);
+        if (local != -1)
+        {
+            state.enclosing->locals[local].isCaptured = true;
+            return addUpvalue(state, static_cast<std::uint8_t>(local), true);
+        }
+
+        int upvalue = resolveUpvalue(*state.enclosing, name);
+        if (upvalue != -1)
+            return addUpvalue(state, static_cast<std::uint8_t>(upvalue), false);
+
+        return -1;
+    }
+
+    int Compiler::addUpvalue(FunctionState& state, std::uint8_t index, bool isLocal)
+    {
+        for (std::size_t i = 0; i < state.upvalues.size(); i++)
+        {
+            if (state.upvalues[i].index == index && state.upvalues[i].isLocal == isLocal)
+                return static_cast<int>(i);
+        }
+
+        if (state.upvalues.size() > std::numeric_limits<std::uint8_t>::max())
+        {
+            error("Too many closure variables in function.");
+            return 0;
+        }
+
+        state.upvalues.push_back(Upvalue{index, isLocal});
+        return static_cast<int>(state.upvalues.size()) - 1;
+    }
+
+    Chunk& Compiler::currentChunk()
+    {
+        return current->function->chunk;
+    }
+
+    void Compiler::emit(std::uint8_t byte)
+    {
+        currentChunk().write(byte, line);
+    }
+
+    void Compiler::emit(OpCode op)
+    {
+        currentChunk().write(op, line);
+    }
+
+    void Compiler::emitShort(int value)
+    {
+        emit(static_cast<std::uint8_t>((value >> 8) & 0xff));
+        emit(static_cast<std::uint8_t>(value & 0xff));
+    }
+
+    void Compiler::emitConstant(const Value& value)
+    {
+        emit(OpCode::CONSTANT);
+        emitShort(makeConstant(value));
+    }
+
+    void Compiler::emitReturn()
+    {
+        if (current->type == TYPE_INITIALIZER)
+        {
+            emit(OpCode::GET_LOCAL);
+            emit(static_cast<std::uint8_t>(0));
+        }
+        else
+        {
+            emit(OpCode::NIL);
+        }
+        emit(OpCode::RETURN);
+    }
+
+    int Compiler::emitJump(OpCode op)
+    {
+        emit(op);
+        emit(static_cast<std::uint8_t>(0xff));
+        emit(static_cast<std::uint8_t>(0xff));
+        return static_cast<int>(currentChunk().code.size()) - 2;
+    }
+
+    void Compiler::patchJump(int offset)
+    {
+        // -2 to adjust for the bytecode of the jump offset itself.
+        int jump = static_cast<int>(currentChunk().code.size()) - offset - 2;
+        if (jump > std::numeric_limits<std::uint16_t>::max())
+        {
+            error("Too much code to jump over.");
+        }
+
+        currentChunk().code[offset] = static_cast<std::uint8_t>((jump >> 8) & 0xff);
+        currentChunk().code[offset + 1] = static_cast<std::uint8_t>(jump & 0xff);
+    }
+
+    void Compiler::emitLoop(int loopStart)
+    {
+        emit(OpCode::LOOP);
+
+        int offset = static_cast<int>(currentChunk().code.size()) - loopStart + 2;
+        if (offset > std::numeric_limits<std::uint16_t>::max())
+        {
+            error("Loop body too large.");
+        }
+        emitShort(offset);
+    }
+
+    int Compiler::makeConstant(const Value& value)
+    {
+        int constant = currentChunk().addConstant(value);
+        if (constant > std::numeric_limits<std::uint16_t>::max())
+        {
+            error("Too many constants in one chunk.");
+            return 0;
+        }
+        return constant;
+    }
+
+    int Compiler::identifierConstant(std::string_view name)
+    {
+        Ref<LoxString> string = vm.intern(name);
+        auto it = current->identifiers.find(string.get());
+        if (it != current->identifiers.end())
+            return it->second;
+
+        int constant = makeConstant(string);
+        current->identifiers.emplace(string.get(), constant);
+        return constant;
+    }
+
+    void Compiler::error(const char* message)
+    {
+        Lox::Error(line, message);
+        hadError = true;
+    }
+}
@@ -1,6 +1,7 @@
 #include "Environment.h"
 
 #include "RuntimeError.h"
+#include "RunStats.h"
 #include "Token.h"
 
 #include <cassert>
@@ -11,12 +12,15 @@ namespace Lox
 {
 
   Environment::Environment()
-  : enclosing(nullptr)    
-  {}
-  Environment::Environment(std::shared_ptr<Environment> enclosing)
-  : enclosing(enclosing) 
+  : Object(ObjectType::ENVIRONMENT), enclosing(nullptr)    
+  {
+    RunStats::current.environments++;
+  }
+  Environment::Environment(Ref<Environment> enclosing)
+  : Object(ObjectType::ENVIRONMENT), enclosing(std::move(enclosing)) 
   {
     assert(this->enclosing != nullptr);
+    RunStats::current.environments++;
   }
   
 /*
@@ -24,9 +28,9 @@ namespace Lox
   : enclosing(other.enclosing)
   {}
 */
-  const std::any& Environment::get(const Token& name) const
+  const Value& Environment::get(const Token& name) const
   {
-    auto it = values.find(name.lexeme); 
+    auto it = values.find(name.lexeme);
     if(it != values.end())
     {
       return it->second;
@@ -38,23 +42,23 @@ namespace Lox
     throw RuntimeError(name, fmt::format("Undefined variable '{}'.", name.lexeme));
   }
 
-  const std::any& Environment::getAt(int distance, const std::string& name)
+  const Value& Environment::getAt(int distance, int slot)
   {
-    return ancestor(distance)->values.at(name);
+    return ancestor(distance)->slots[slot];
   }
 
-  std::shared_ptr<Environment> Environment::ancestor(int distance)
+  Environment* Environment::ancestor(int distance)
   {
-    auto environment = shared_from_this();
+    Environment* environment = this;
     for (int i = 0; i < distance; i++)
     {
-      environment = environment->enclosing;
+      environment = environment->enclosing.get();
     }
 
     return environment;
   }
 
-  void Environment::assign(const Token& name, const std::any& value)
+  void Environment::assign(const Token& name, const Value& value)
   {
     auto it = values.find(name.lexeme);
     if(it != values.end())
@@ -72,14 +76,45 @@ namespace Lox
     throw RuntimeError(name, fmt::format("Undefined variable '{}'.", name.lexeme));
   }
 
-  void Environment::assignAt(int distance, const Token& name, std::any& value)
+  void Environment::assignAt(int distance, int slot, const Value& value)
+  {
+    ancestor(distance)->slots[slot] = value;
+  }
+
+  void Environment::define(std::string_view name, const Value& value)
+  {
+    if (enclosing == nullptr)
+    {
+      auto it = values.find(name);
+      if (it != values.end())
+      {
+        it->second = value;
+        return;
+      }
+      const std::string& owned = *names.emplace(name).first;
+      values.emplace(owned, value);
+      return;
+    }
+
+    // Locals are defined in the same order the Resolver numbered them.
+    slots.push_back(value);
+  }
+
+  void Environment::trace(Tracer& tracer) const
   {
-    ancestor(distance)->values[name.lexeme] = value;
+    tracer.visit(enclosing);
+    for (const auto& [name, value] : values)
+      tracer.visit(value);
+    for (const Value& value : slots)
+      tracer.visit(value);
   }
 
-  void Environment::define(const std::string& name, const std::any& value)
+  void Environment::clearReferences()
   {
-    values.emplace(name, value); 
+    enclosing = nullptr;
+    values.clear();
+    names.clear();
+    slots.clear();
   }
 }
 
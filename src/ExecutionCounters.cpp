@@ -0,0 +1,143 @@
+#include "ExecutionCounters.h"
+
+#include <algorithm>
+
+#include <fmt/core.h>
+
+#include "Stmt/Stmt.h"
+#include "Timing.h"
+
+namespace Lox
+{
+    bool ExecutionCounters::enabled = false;
+    std::vector<ExecutionCounters::LineStats> ExecutionCounters::lines;
+    std::vector<int> ExecutionCounters::running;
+    double ExecutionCounters::lastEvent = 0;
+    std::unordered_map<const Function*, ExecutionCounters::FunctionStats> ExecutionCounters::functions;
+
+    namespace
+    {
+        template<typename Entry>
+        void sortByTime(std::vector<Entry>& entries)
+        {
+            std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+                return a.seconds > b.seconds;
+            });
+        }
+    }
+
+    void ExecutionCounters::enable()
+    {
+        enabled = true;
+        // Line 0 is where synthesized statements at the top level are timed.
+        lines.resize(1);
+    }
+
+    void ExecutionCounters::charge(double now)
+    {
+        if (!running.empty())
+            lines[running.back()].seconds += now - lastEvent;
+        lastEvent = now;
+    }
+
+    void ExecutionCounters::enterStatement(int line)
+    {
+        charge(clockSeconds());
+        if (line == 0)
+        {
+            running.push_back(running.empty() ? 0 : running.back());
+            return;
+        }
+        if (static_cast<std::size_t>(line) >= lines.size())
+            lines.resize(line + 1);
+        lines[line].count++;
+        running.push_back(line);
+    }
+
+    void ExecutionCounters::leaveStatement()
+    {
+        charge(clockSeconds());
+        running.pop_back();
+    }
+
+    void ExecutionCounters::enterFunction(const Function* declaration)
+    {
+        FunctionStats& stats = functions[declaration];
+        stats.calls++;
+        if (stats.depth++ == 0)
+            stats.start = clockSeconds();
+    }
+
+    void ExecutionCounters::leaveFunction(const Function* declaration)
+    {
+        FunctionStats& stats = functions[declaration];
+        if (--stats.depth == 0)
+            stats.seconds += clockSeconds() - stats.start;
+    }
+
+    std::vector<ExecutionCounters::LineEntry> ExecutionCounters::sortedLines()
+    {
+        std::vector<LineEntry> entries;
+        for (std::size_t line = 1; line < lines.size(); line++)
+        {
+            if (lines[line].count != 0)
+                entries.push_back({static_cast<int>(line), lines[line].count, lines[line].seconds});
+        }
+        sortByTime(entries);
+        return entries;
+    }
+
+    std::vector<ExecutionCounters::FunctionEntry> ExecutionCounters::sortedFunctions()
+    {
+        std::vector<FunctionEntry> entries;
+        for (const auto& [declaration, stats] : functions)
+            entries.push_back({declaration, stats.calls, stats.seconds});
+        sortByTime(entries);
+        return entries;
+    }
+
+    void ExecutionCounters::printReport(std::FILE* file)
+    {
+        std::vector<LineEntry> lineEntries = sortedLines();
+        std::vector<FunctionEntry> functionEntries = sortedFunctions();
+
+        fmt::print(file, "[counters] {:>8} {:>12} {:>12}\n", "line", "count", "self ms");
+        for (const LineEntry& entry : lineEntries)
+            fmt::print(file, "[counters] {:>8} {:>12} {:>12.3f}\n", entry.line, entry.count, entry.seconds * 1000);
+
+        fmt::print(file, "[counters] {:<20} {:>8} {:>12} {:>12}\n", "function", "line", "calls", "total ms");
+        for (const FunctionEntry& entry : functionEntries)
+        {
+            fmt::print(file, "[counters] {:<20} {:>8} {:>12} {:>12.3f}\n", entry.declaration->getName().lexeme,
+                entry.declaration->line, entry.calls, entry.seconds * 1000);
+        }
+    }
+
+    bool ExecutionCounters::writeJson(const std::string& path)
+    {
+        std::FILE* file = std::fopen(path.c_str(), "w");
+        if (file == nullptr)
+            return false;
+
+        std::vector<LineEntry> lineEntries = sortedLines();
+        std::vector<FunctionEntry> functionEntries = sortedFunctions();
+
+        fmt::print(file, "{{\n  \"lines\": [");
+        for (std::size_t i = 0; i < lineEntries.size(); i++)
+        {
+            const LineEntry& entry = lineEntries[i];
+            fmt::print(file, "{}\n    {{\"line\": {}, \"count\": {}, \"seconds\": {}}}", i == 0 ? "" : ",",
+                entry.line, entry.count, entry.seconds);
+        }
+        fmt::print(file, "\n  ],\n  \"functions\": [");
+        for (std::size_t i = 0; i < functionEntries.size(); i++)
+        {
+            // Function names are identifiers, so they never need escaping.
+            const FunctionEntry& entry = functionEntries[i];
+            fmt::print(file, "{}\n    {{\"name\": \"{}\", \"line\": {}, \"calls\": {}, \"seconds\": {}}}", i == 0 ? "" : ",",
+                entry.declaration->getName().lexeme, entry.declaration->line, entry.calls, entry.seconds);
+        }
+        fmt::print(file, "\n  ]\n}}\n");
+        return std::fclose(file) == 0;
+    }
+}
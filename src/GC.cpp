@@ -0,0 +1,114 @@
+#include "GC.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <fmt/core.h>
+
+namespace Lox
+{
+    Object* GC::objects = nullptr;
+    std::size_t GC::allocations = 0;
+    std::size_t GC::threshold = GC::MIN_THRESHOLD;
+    GC::Stats GC::stats;
+
+    void Object::track()
+    {
+        tracked = true;
+        gcNext = GC::objects;
+        if (gcNext)
+            gcNext->gcPrev = this;
+        GC::objects = this;
+
+        GC::allocations++;
+        GC::stats.liveObjects++;
+        GC::stats.peakObjects = std::max(GC::stats.peakObjects, GC::stats.liveObjects);
+    }
+
+    void Object::untrack()
+    {
+        if (gcPrev)
+            gcPrev->gcNext = gcNext;
+        else
+            GC::objects = gcNext;
+        if (gcNext)
+            gcNext->gcPrev = gcPrev;
+
+        GC::stats.liveObjects--;
+    }
+
+    void GC::collect()
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        for (Object* object = objects; object; object = object->gcNext)
+        {
+            object->gcRefs = object->refCount;
+            object->marked = false;
+        }
+
+        // Take away every reference that comes from another tracked object.
+        struct InternalReferences : Tracer
+        {
+            void visit(Object* object) override
+            {
+                if (object->tracked)
+                    object->gcRefs--;
+            }
+        } internal;
+        for (Object* object = objects; object; object = object->gcNext)
+            object->trace(internal);
+
+        struct Marker : Tracer
+        {
+            void visit(Object* object) override
+            {
+                if (object->tracked && !object->marked)
+                {
+                    object->marked = true;
+                    grey.push_back(object);
+                }
+            }
+            std::vector<Object*> grey;
+        } marker;
+        for (Object* object = objects; object; object = object->gcNext)
+        {
+            if (object->gcRefs > 0)
+                marker.visit(object);
+        }
+        while (!marker.grey.empty())
+        {
+            Object* object = marker.grey.back();
+            marker.grey.pop_back();
+            object->trace(marker);
+        }
+
+        // Hold on to the garbage while it is being cleared so nothing is
+        // freed until every cycle has been broken.
+        std::vector<Ref<Object>> garbage;
+        for (Object* object = objects; object; object = object->gcNext)
+        {
+            if (!object->marked)
+                garbage.emplace_back(object);
+        }
+        for (const Ref<Object>& object : garbage)
+            object->clearReferences();
+        stats.objectsFreed += garbage.size();
+        garbage.clear();
+
+        allocations = 0;
+        threshold = std::max(MIN_THRESHOLD, stats.liveObjects);
+        stats.collections++;
+        stats.milliseconds += std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+
+    void GC::printStats()
+    {
+        fmt::print(stderr, "[gc] collections: {}\n", stats.collections);
+        fmt::print(stderr, "[gc] objects freed in cycles: {}\n", stats.objectsFreed);
+        fmt::print(stderr, "[gc] live objects: {} (peak {})\n", stats.liveObjects, stats.peakObjects);
+        fmt::print(stderr, "[gc] time: {:.3f} ms\n", stats.milliseconds);
+    }
+}
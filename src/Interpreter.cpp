@@ -1,29 +1,68 @@
 #include <fmt/core.h>
 
 #include "Interpreter.h"
+#include "GC.h"
 #include "Lox.h"
+#include "AllocationProfiler.h"
+#include "ExecutionCounters.h"
 #include "LoxClass.h"
+#include "Profiler.h"
+#include "RunStats.h"
+#include "Timing.h"
+#include "TraceEvents.h"
 
 #include <iostream>
 
 namespace Lox
 {
-    std::any clock(Interpreter&, const std::vector<std::any>&)
+    Value clockNative(Interpreter&, const std::vector<Value>&)
     {
-        std::time_t t = std::time(nullptr);
-        return static_cast<double>(t);
+        return clockSeconds();
     }
 
-    Interpreter::Interpreter(std::ostream& out) : out(out), globals(std::make_shared<Environment>()), 
-    globalEnvironment(globals.get()) 
+    Value clockNanosNative(Interpreter&, const std::vector<Value>&)
     {
-        globals->define("clock", std::make_shared<LoxFunction>(0, &clock));
+        return clockNanos();
+    }
+
+    // bench(fn, iterations) calls fn that many times, timing each call, and
+    // returns a BenchStats instance with the per-call times in seconds.
+    Value benchNative(Interpreter& interpreter, const std::vector<Value>& arguments)
+    {
+        const Value& fn = arguments[0];
+        if (!fn.isCallable() || fn.asCallable()->getArity() != 0)
+            throw NativeError("bench() expects a function taking no arguments.");
+        if (!arguments[1].isNumber() || !isValidBenchIterations(arguments[1].asNumber()))
+            throw NativeError("bench() expects a whole number of iterations from 1 to 10000000.");
+
+        Callable* callable = fn.asCallable();
+        const std::vector<Value> noArguments;
+        const std::size_t iterations = static_cast<std::size_t>(arguments[1].asNumber());
+        std::vector<double> samples;
+        samples.reserve(iterations);
+        for (std::size_t i = 0; i < iterations; i++)
+        {
+            double start = clockSeconds();
+            callable->call(interpreter, noArguments);
+            samples.push_back(clockSeconds() - start);
+        }
+
+        return interpreter.makeBenchStats(TimingStats::summarize(samples));
+    }
+
+    Interpreter::Interpreter(std::ostream& out) : out(out), globals(makeRef<Environment>()), 
+    globalEnvironment(globals.get()),
+    benchStatsClass(makeRef<LoxClass>("BenchStats", nullptr, std::unordered_map<std::string_view, Ref<LoxFunction>>{}))
+    {
+        globals->define("clock", makeRef<LoxFunction>(0, &clockNative));
+        globals->define("clockNanos", makeRef<LoxFunction>(0, &clockNanosNative));
+        globals->define("bench", makeRef<LoxFunction>(2, &benchNative));
         environment = globals;
     }
 
     Interpreter::~Interpreter() = default;
     
-    void Interpreter::interpret(const std::vector<std::shared_ptr<Stmt>>& statements)
+    void Interpreter::interpret(const std::vector<Stmt*>& statements)
     {
         try {
             for(const auto& ptr : statements)
@@ -32,8 +71,20 @@ namespace Lox
                 execute(ptr);
             }
         } catch (RuntimeError error) {
+            out.flush();
             Lox::ReportRuntimeError(error);
         }
+        out.flush();
+    }
+
+    Value Interpreter::makeBenchStats(const TimingStats& stats)
+    {
+        Ref<LoxInstance> instance = makeRef<LoxInstance>(benchStatsClass);
+        stats.forEachField([&](const char* name, double value) {
+            InlineCache cache;
+            instance->set(Token(TokenType::IDENTIFIER, name, 0), value, cache);
+        });
+        return instance;
     }
 
     Environment& Interpreter::getGlobalsEnvironment()
@@ -42,151 +93,180 @@ namespace Lox
         return *globalEnvironment;
     }
 
-    void Interpreter::execute(std::shared_ptr<Stmt> stmt)
+    ExecStatus Interpreter::execute(Stmt* stmt)
+    {
+        GC::collectIfNeeded();
+        if (instrumented)
+            return executeInstrumented(stmt);
+        return stmt->accept(*this);
+    }
+
+    ExecStatus Interpreter::executeInstrumented(Stmt* stmt)
     {
-        stmt->accept(*this);
+        if (Profiler::isRunning())
+            Profiler::step(stmt->line);
+
+        // Tells the counters and the allocation profiler which statement is
+        // running until it finishes or a runtime error unwinds it.
+        struct StatementScope
+        {
+            explicit StatementScope(int line)
+            {
+                if (ExecutionCounters::isEnabled())
+                    ExecutionCounters::enterStatement(line);
+                if (AllocationProfiler::isEnabled())
+                    AllocationProfiler::enterStatement(line);
+            }
+            ~StatementScope()
+            {
+                if (ExecutionCounters::isEnabled())
+                    ExecutionCounters::leaveStatement();
+                if (AllocationProfiler::isEnabled())
+                    AllocationProfiler::leaveStatement();
+            }
+        } scope(stmt->line);
+        return stmt->accept(*this);
     }
 
-    void Interpreter::executeBlock(const std::vector<std::shared_ptr<Stmt>>& statements, 
-            std::shared_ptr<Environment> Lenvironment)
+    ExecStatus Interpreter::executeBlock(const std::vector<Stmt*>& statements, 
+            Ref<Environment> Lenvironment)
     {
         EnterEnvironmentGuard ee{*this, Lenvironment};
         for(const auto& statementPtr : statements) {
           assert(statementPtr != nullptr);
-          execute(statementPtr);
+          if (execute(statementPtr) == ExecStatus::RETURN)
+            return ExecStatus::RETURN;
         }
+        return ExecStatus::NORMAL;
     }
 
-    void Interpreter::resolve(const std::shared_ptr<Expr>& expr, int depth)
-    {
-        locals[expr] = depth;
-    }
-
-    std::any Interpreter::visit_block_stmt(std::shared_ptr<Block> stmt)
+    ExecStatus Interpreter::visit_block_stmt(Block* stmt)
     {
-        auto env = std::make_shared<Environment>(this->environment);
-        executeBlock(stmt->getStmt(), env);
-        return {}; 
+        auto env = makeRef<Environment>(this->environment);
+        return executeBlock(stmt->getStmt(), env);
     }
 
-    std::any Interpreter::visit_class_stmt(std::shared_ptr<Class> stmt)
+    ExecStatus Interpreter::visit_class_stmt(Class* stmt)
     {
 
-        std::any superklass;
+        Value superklass;
         if (stmt->superclass != nullptr)
         {
             superklass = evaluate(stmt->superclass);
-            if (superklass.type() != typeid(std::shared_ptr<LoxClass>))
+            if (!superklass.isClass())
             {
                 throw RuntimeError(stmt->superclass->name, "Superclass must be a class.");
             }
         }
-        environment->define(stmt->getName().lexeme, std::any{});
-
         if (stmt->superclass != nullptr)
         {
-            environment = std::make_shared<Environment>(environment);
+            environment = makeRef<Environment>(environment);
             environment->define("super", superklass);
         }
 
-        std::unordered_map<std::string, std::shared_ptr<LoxFunction>> methods;
+        std::unordered_map<std::string_view, Ref<LoxFunction>> methods;
         for(auto& method : stmt->methods)
         {
-            std::shared_ptr<LoxFunction> function = std::make_shared<LoxFunction>(method, environment, method->name.lexeme == "init");
+            Ref<LoxFunction> function = makeRef<LoxFunction>(method, environment, method->name.lexeme == "init");
             methods[method->name.lexeme] = std::move(function);
         }
-        std::shared_ptr<LoxClass> klass;
-        if (superklass.has_value())
+        Ref<LoxClass> klass;
+        if (!superklass.isNil())
         {
-            klass = std::make_shared<LoxClass>(stmt->getName().lexeme, std::any_cast<std::shared_ptr<LoxClass>>(superklass), methods);
+            klass = makeRef<LoxClass>(stmt->getName().lexeme, superklass.asClass(), std::move(methods));
             environment = environment->enclosing;
         }
         else 
         {
-            klass = std::make_shared<LoxClass>(stmt->getName().lexeme, nullptr, methods);
+            klass = makeRef<LoxClass>(stmt->getName().lexeme, nullptr, std::move(methods));
         }
 
-        environment->assign(stmt->getName(), klass);
-        return {};
+        // Defined only now so that a local class takes the slot the Resolver
+        // gave it; methods see the name through their closure either way.
+        environment->define(stmt->getName().lexeme, klass);
+        return ExecStatus::NORMAL;
     }
 
-    std::any Interpreter::visit_expression_stmt(std::shared_ptr<Expression> stmt)
+    ExecStatus Interpreter::visit_expression_stmt(Expression* stmt)
     {
         evaluate(stmt->expr);
-        return {};
+        return ExecStatus::NORMAL;
     }
 
-    std::any Interpreter::visit_if_stmt(std::shared_ptr<If> stmt)
+    ExecStatus Interpreter::visit_if_stmt(If* stmt)
     {
         if(isTruthy(evaluate(stmt->condition)))
         {
-            execute(stmt->thenBranch);
+            return execute(stmt->thenBranch);
         } else if (stmt->elseBranch != nullptr)
         {
-            execute(stmt->elseBranch);
+            return execute(stmt->elseBranch);
         }
-        return {};
+        return ExecStatus::NORMAL;
     }
 
-    std::any Interpreter::visit_function_stmt(std::shared_ptr<Function> stmt)
+    ExecStatus Interpreter::visit_function_stmt(Function* stmt)
     {
 //        const Callable function(&stmt, std::make_unique<Environment>(environment.get()));
         //static_assert(std::is_copy_constructible_v<Callable>);
-        //auto fun = Callable(&stmt, std::make_shared<Environment>(*environment));
-        auto fun = std::make_shared<LoxFunction>(stmt, environment, false);
+        //auto fun = Callable(&stmt, arena.make<Environment>(*environment));
+        auto fun = makeRef<LoxFunction>(stmt, environment, false);
         environment->define(stmt->getName().lexeme, fun);
-        return {};
+        return ExecStatus::NORMAL;
     }
 
-    std::any Interpreter::visit_print_stmt(std::shared_ptr<Print> stmt)
+    ExecStatus Interpreter::visit_print_stmt(Print* stmt)
     {
-        std::any value = evaluate(stmt->expr);
-        // Using cout here because idk how to use the fmt library
-        out << stringify(value) << std::endl;
-        return {};
+        Value value = evaluate(stmt->expr);
+        print(value);
+        if (buffering == OutputBuffering::LINE)
+            out.flush();
+        return ExecStatus::NORMAL;
     }
 
-    std::any Interpreter::visit_return_stmt(std::shared_ptr<Return> stmt)
+    ExecStatus Interpreter::visit_return_stmt(Return* stmt)
     {
-        std::any value;
-        if(stmt->value.get() != nullptr) 
+        Value value;
+        if(stmt->value != nullptr) 
         {
             value = evaluate(stmt->value);
         }
 
-        throw ReturnException(value);
+        returnValue = std::move(value);
+        RunStats::current.returns++;
+        return ExecStatus::RETURN;
     }
 
-    std::any Interpreter::visit_var_stmt(std::shared_ptr<Var> stmt)
+    ExecStatus Interpreter::visit_var_stmt(Var* stmt)
     {
-      std::any value;
+      Value value;
       if (stmt->initializer != nullptr)
       {
         value = evaluate(stmt->initializer);
       }
 
       environment->define(stmt->getName().lexeme, value);
-      return {};
+      return ExecStatus::NORMAL;
     }
 
-    std::any Interpreter::visit_while_stmt(std::shared_ptr<While> stmt)
+    ExecStatus Interpreter::visit_while_stmt(While* stmt)
     {
         while(isTruthy(evaluate(stmt->condition)))
         {
-            execute(stmt->body);
+            if (execute(stmt->body) == ExecStatus::RETURN)
+                return ExecStatus::RETURN;
         }
 
-        return {};
+        return ExecStatus::NORMAL;
     }
 
-    std::any Interpreter::visit_assign_expr(std::shared_ptr<Assign> expr)
+    Value Interpreter::visit_assign_expr(Assign* expr)
     {
-      std::any value = evaluate(expr->value);
+      Value value = evaluate(expr->value);
       assert(environment != nullptr);
-      if(locals.find(expr) != locals.end())
+      if(expr->resolved.isLocal())
       {
-        int distance = locals.at(expr);
-        environment->assignAt(distance, expr->name, value);
+        environment->assignAt(expr->resolved.depth, expr->resolved.slot, value);
       } else
       {
         globals->assign(expr->getName(), value);
@@ -194,14 +274,14 @@ namespace Lox
       return value;
     }
 
-    std::any Interpreter::visit_literal_expr(std::shared_ptr<Literal> expr)
+    Value Interpreter::visit_literal_expr(Literal* expr)
     {
         return expr->getLiteral();
     }
 
-    std::any Interpreter::visit_logical_expr(std::shared_ptr<Logical> expr)
+    Value Interpreter::visit_logical_expr(Logical* expr)
     {
-        std::any left = evaluate(expr->left);
+        Value left = evaluate(expr->left);
 
         if(expr->getOp().getType() == TokenType::OR)
         {
@@ -214,77 +294,77 @@ namespace Lox
         return evaluate(expr->right);
     }
 
-    std::any Interpreter::visit_set_expr(std::shared_ptr<Set> expr)
+    Value Interpreter::visit_set_expr(Set* expr)
     {
-        std::any object = evaluate(expr->object);
+        Value object = evaluate(expr->object);
 
-        if (!(object.type() == typeid(std::shared_ptr<LoxInstance>)))
+        if (!object.isInstance())
         {
             throw RuntimeError(expr->name, "Only instances have fields.");
         }
 
-        std::any value = evaluate(expr->value);
-        std::any_cast<std::shared_ptr<LoxInstance>>(object)->set(expr->name, value);
+        Value value = evaluate(expr->value);
+        object.asInstance()->set(expr->name, value, expr->cache);
         return value;
     }
 
-    std::any Interpreter::visit_super_expr(std::shared_ptr<Super> expr)
+    Value Interpreter::visit_super_expr(Super* expr)
     {
-        int distance = locals.at(expr);
-        // Might need type checking?
-        auto superklass = std::any_cast<std::shared_ptr<LoxClass>>(environment->getAt(distance, "super"));
+        int distance = expr->resolved.depth;
+        // "super" is the only slot of its environment, which directly encloses
+        // the method's, where "this" is always the first slot.
+        LoxClass* superklass = environment->getAt(distance, 0).asClass();
 
-        auto object = std::any_cast<std::shared_ptr<LoxInstance>>(environment->getAt(distance - 1, "this"));
+        LoxInstance* object = environment->getAt(distance - 1, 0).asInstance();
 
-        std::shared_ptr<LoxFunction> method = superklass->findMethod(expr->method.lexeme);
+        LoxFunction* method = superklass->findMethod(expr->method.lexeme);
 
         if (method == nullptr)
         {
-            throw RuntimeError(expr->method, "Undefined property '" + expr->method.lexeme + "'.");
+            throw RuntimeError(expr->method, fmt::format("Undefined property '{}'.", expr->method.lexeme));
         }
 
         return method->bind(object);
     }
 
-    std::any Interpreter::visit_this_expr(std::shared_ptr<This> expr)
+    Value Interpreter::visit_this_expr(This* expr)
     {
-        return lookUpVariable(expr->keyword, expr);
+        return lookUpVariable(expr->keyword, expr->resolved);
     }
 
-    std::any Interpreter::visit_grouping_expr(std::shared_ptr<Grouping> expr)
+    Value Interpreter::visit_grouping_expr(Grouping* expr)
     {
         return evaluate(expr->expr);
     }
 
-    std::any Interpreter::visit_unary_expr(std::shared_ptr<Unary> expr)
+    Value Interpreter::visit_unary_expr(Unary* expr)
     {
-        const std::any right = evaluate(expr->right);
+        const Value right = evaluate(expr->right);
 
         switch(expr->getOp().getType())
         {
             case TokenType::MINUS:
                 checkNumberOperand(expr->getOp(), right);
-                return -(std::any_cast<double>(right));
+                return -right.asNumber();
             case TokenType::BANG:
                 return !isTruthy(right);
             default:
-            return std::any{};
+            return Value{};
 
         }
     }
 
-    std::any Interpreter::visit_variable_expr(std::shared_ptr<Variable> expr)
+    Value Interpreter::visit_variable_expr(Variable* expr)
     {
       assert(environment != nullptr);
-      return lookUpVariable(expr->name, expr);
+      return lookUpVariable(expr->name, expr->resolved);
     }
 
-    std::any Interpreter::lookUpVariable(const Token& name, std::shared_ptr<Expr> expr)
+    Value Interpreter::lookUpVariable(const Token& name, const ResolvedSlot& resolved)
     {
-        if(locals.find(expr) != locals.end())
+        if(resolved.isLocal())
         {
-            int dist = locals[expr];
-            return environment->getAt(dist, name.lexeme);
+            return environment->getAt(resolved.depth, resolved.slot);
         }
         else
         {
@@ -292,194 +372,211 @@ namespace Lox
         }
     }
 
-    std::any Interpreter::visit_binary_expr(std::shared_ptr<Binary> expr)
+    Value Interpreter::visit_binary_expr(Binary* expr)
     {
-        const std::any left = evaluate(expr->left);
-        const std::any right = evaluate(expr->right);
+        const Value left = evaluate(expr->left);
+        const Value right = evaluate(expr->right);
 
         switch(expr->getOp().getType())
         {   
             case TokenType::GREATER:
                 checkNumberOperands(expr->getOp(), left, right);
-                return std::any_cast<double>(left) > std::any_cast<double>(right);
+                return left.asNumber() > right.asNumber();
             case TokenType::GREATER_EQUAL:
                 checkNumberOperands(expr->getOp(), left, right);
-                return std::any_cast<double>(left) >= std::any_cast<double>(right);
+                return left.asNumber() >= right.asNumber();
             case TokenType::LESS:
                 checkNumberOperands(expr->getOp(), left, right);
-                return std::any_cast<double>(left) < std::any_cast<double>(right);
+                return left.asNumber() < right.asNumber();
             case TokenType::LESS_EQUAL:
                 checkNumberOperands(expr->getOp(), left, right);
-                return std::any_cast<double>(left) <= std::any_cast<double>(right);
+                return left.asNumber() <= right.asNumber();
             case TokenType::BANG_EQUAL:
                 return !isEqual(left, right);
             case TokenType::EQUAL_EQUAL:
                 return isEqual(left, right);
             case TokenType::MINUS:
                 checkNumberOperands(expr->getOp(), left, right);
-                return std::any_cast<double>(left) - std::any_cast<double>(right);
+                return left.asNumber() - right.asNumber();
             case TokenType::PLUS:
-                if(left.type() == typeid(double) && right.type() == typeid(double))
-                    return std::any_cast<double>(left) + std::any_cast<double>(right);
+                if(left.isNumber() && right.isNumber())
+                    return left.asNumber() + right.asNumber();
 
-                if(left.type() == typeid(std::string) && right.type() == typeid(std::string))
-                    return std::any_cast<std::string>(left) + std::any_cast<std::string>(right);
+                if(left.isString() && right.isString())
+                    return concatenate(*left.asString(), *right.asString());
 
                 throw RuntimeError(expr->getOp(),
                     "Operands must be two numbers or two strings.");  
             case TokenType::SLASH:
                 checkNumberOperands(expr->getOp(), left, right);
-                return std::any_cast<double>(left) / std::any_cast<double>(right);
+                return left.asNumber() / right.asNumber();
             case TokenType::STAR:
                 checkNumberOperands(expr->getOp(), left, right);
-                return std::any_cast<double>(left) * std::any_cast<double>(right); 
+                return left.asNumber() * right.asNumber(); 
+        }
+
+        return Value{};
+    }
+
+    Value Interpreter::visit_call_expr(Call* expr)
+    {
+        if (expr->method != nullptr)
+        {
+            return invoke(*expr, *expr->method);
         }
 
-        return std::any{};
+        Value callee = evaluate(expr->callee);
+        return callValue(callee, *expr);
     }
 
-    std::any Interpreter::visit_call_expr(std::shared_ptr<Call> expr)
+    Value Interpreter::callValue(const Value& callee, const Call& expr)
     {
-        auto callee = std::make_shared<std::any>(evaluate(expr->callee));
+        std::vector<Value> arguments = evaluateArguments(expr);
 
-        std::vector<std::any> arguments;
-        for(const auto& argument : expr->getArguments())
+        if(!callee.isCallable())
         {
-            arguments.push_back(evaluate(argument));
+            throw RuntimeError(expr.getParen(), "Can only call functions and classes.");
         }
+        Callable* function = callee.asCallable();
+        checkArity(expr.getParen(), function->getArity(), arguments.size());
 
-        // This is a terrible solution, but I made the mistake of using std::any so this code is the result
-        // Have to check whether the the callee is a function or a class before casting it in to a Callable 
-        // pointer
-        std::shared_ptr<Callable> function;
+        try {
+            return function->call(*this, arguments);
+        } catch (const NativeError& error) {
+            throw RuntimeError(expr.getParen(), error.what());
+        }
+    }
 
-        if(callee->type() == typeid(std::shared_ptr<LoxFunction>))
+    // obj.method(args) calls the method with obj as its receiver instead of
+    // first creating a bound method and then calling that.
+    Value Interpreter::invoke(const Call& expr, Get& get)
+    {
+        Value object = evaluate(get.object);
+        if(!object.isInstance())
         {
-            function = std::any_cast<std::shared_ptr<LoxFunction>>(*callee);
+            throw RuntimeError(get.name, "Only instances have properties.");
         }
-        else if (callee->type() == typeid(std::shared_ptr<LoxClass>))
+        LoxInstance* instance = object.asInstance();
+
+        // Fields shadow methods, and may hold any callable.
+        LoxInstance::Property property = instance->findProperty(get.name, get.cache);
+        if (property.field != nullptr)
         {
-            function = std::any_cast<std::shared_ptr<LoxClass>>(*callee);
+            Value callee = *property.field;
+            return callValue(callee, expr);
         }
-        else
+
+        LoxFunction* method = property.method;
+        if (method == nullptr)
         {
-            throw RuntimeError(expr->getParen(), "Can only call functions and classes.");
+            throw RuntimeError(get.name, fmt::format("Undefined property '{}'.", get.name.lexeme));
         }
 
-        if(arguments.size() != function->getArity()) 
+        std::vector<Value> arguments = evaluateArguments(expr);
+        checkArity(expr.getParen(), method->getArity(), arguments.size());
+
+        return method->callMethod(*this, object, arguments);
+    }
+
+    std::vector<Value> Interpreter::evaluateArguments(const Call& expr)
+    {
+        std::vector<Value> arguments;
+        arguments.reserve(expr.getArguments().size());
+        for(const auto& argument : expr.getArguments())
         {
-            throw RuntimeError(expr->getParen(), fmt::format("Expected {} arguments, but got {}.",
-                function->getArity(), arguments.size()));
+            arguments.push_back(evaluate(argument));
         }
+        return arguments;
+    }
 
-        return function->call(*this, arguments);
+    void Interpreter::checkArity(const Token& paren, int arity, std::size_t count) const
+    {
+        if(count != static_cast<std::size_t>(arity)) 
+        {
+            throw RuntimeError(paren, fmt::format("Expected {} arguments, but got {}.",
+                arity, count));
+        }
     }
 
-    std::any Interpreter::visit_get_expr(std::shared_ptr<Get> expr)
+    Value Interpreter::visit_get_expr(Get* expr)
     {
-        std::any object = evaluate(expr->object);
-        if(object.type() == typeid(std::shared_ptr<LoxInstance>))
+        Value object = evaluate(expr->object);
+        if(object.isInstance())
         {
-            return std::any_cast<std::shared_ptr<LoxInstance>>(object)->get(expr->name);
+            return object.asInstance()->get(expr->name, expr->cache);
         }
 
         throw RuntimeError(expr->name, "Only instances have properties.");
     }
 
-    std::string Interpreter::stringify(const std::any& object)
+    std::string Interpreter::stringify(const Value& object)
     {
         //Add support for print functions
-        if(!object.has_value())
+        if(object.isNil())
             return "nil";
-        if(object.type() == typeid(bool))
-            return std::any_cast<bool>(object) ? "true" : "false";
-        if(object.type() == typeid(double))
+        if(object.isBool())
+            return object.asBool() ? "true" : "false";
+        if(object.isNumber())
+            return formatNumber(object.asNumber());
+        if(object.isFunction())
         {
-            double n = std::any_cast<double>(object);
-            if(std::trunc(n) == n) { // is int
-                return std::to_string((int)n);
-            } else {
-                return std::to_string(n);
-            }
+            LoxFunction* function = object.asFunction();
+            if(!function->getDeclaration())
+                return "<native fn>";
+            return fmt::format("<fn {}>", function->getDeclaration()->getName().lexeme);
         }
-        if(object.type() == typeid(std::shared_ptr<LoxFunction>))
-            return fmt::format("<fn {}>", std::any_cast<std::shared_ptr<LoxFunction>>(object)->getDeclaration()->getName().lexeme);
-        if(object.type() == typeid(std::shared_ptr<LoxClass>))
-            return fmt::format("<cl {}>", std::any_cast<std::shared_ptr<LoxClass>>(object)->toString());
-        if(object.type() == typeid(std::shared_ptr<LoxInstance>))
-            return std::any_cast<std::shared_ptr<LoxInstance>>(object)->toString();
-        if(object.type() == typeid(std::string)) 
+        if(object.isClass())
+            return fmt::format("<cl {}>", object.asClass()->toString());
+        if(object.isInstance())
+            return object.asInstance()->toString();
+        if(object.isString()) 
         {
-            return std::any_cast<std::string>(object);
+            return object.asString()->chars;
         }
         //assert(false);
 
         return "";
     } 
 
-    std::any Interpreter::evaluate(std::shared_ptr<Expr> expr)
+    void Interpreter::print(const Value& value)
     {
-        return expr->accept(*this);
+        if (!writeValue(out, value))
+            out << stringify(value);
+        out.put('\n');
     }
 
-    bool Interpreter::isTruthy(const std::any& object) const
+    Value Interpreter::evaluate(Expr* expr)
     {
-        if(!object.has_value())
-        {
-            return false;
-        }
-
-        if(object.type() == typeid(bool))
-        {
-            return std::any_cast<bool>(object);
-        }
-
-        return true;
+        return expr->accept(*this);
     }
 
-    bool Interpreter::isEqual(const std::any& left, const std::any& right) const
+    bool Interpreter::isTruthy(const Value& object) const
     {
-        if(!left.has_value() && !right.has_value())
-            return true;
-        if(!left.has_value())
-            return false;
-        if(left.type() != right.type())
-        {
-            return false;
-        }
-        if(left.type() == typeid(bool))
-        {
-            return std::any_cast<bool>(left) == std::any_cast<bool>(right);
-        }
-        if(left.type() == typeid(double))
-        {
-            return std::any_cast<double>(left) == std::any_cast<double>(right);
-        }
-        if(left.type() == typeid(std::string))
-        {
-            return std::any_cast<std::string>(left) == std::any_cast<std::string>(right);
-        }
+        return object.isTruthy();
+    }
 
-        return false;
+    bool Interpreter::isEqual(const Value& left, const Value& right) const
+    {
+        return left == right;
     }
 
-    void Interpreter::checkNumberOperand(const Token& op, const std::any& operand) const
+    void Interpreter::checkNumberOperand(const Token& op, const Value& operand) const
     {
-        if(operand.type() == typeid(double)) 
+        if(operand.isNumber()) 
             return;
         throw RuntimeError(op, "Operand must be a number.");
     }
 
     void Interpreter::checkNumberOperands(const Token& op, 
-        const std::any& left, const std::any& right) const
+        const Value& left, const Value& right) const
     {
-        if(left.type() == typeid(double) && right.type() == typeid(double)) return;
+        if(left.isNumber() && right.isNumber()) return;
 
         throw RuntimeError(op, "Operands must be numbers.");
     }
 
     Interpreter::EnterEnvironmentGuard::EnterEnvironmentGuard(Interpreter& i,
-          std::shared_ptr<Environment> env)
+          Ref<Environment> env)
     : i(i)
     {
       previous = i.environment;
@@ -491,5 +588,34 @@ namespace Lox
       i.environment = previous;
     }
 
+    Interpreter::CallGuard::CallGuard(Interpreter& i, const Function* declaration)
+    : declaration(declaration), active(i.instrumented)
+    {
+        if (!active)
+            return;
+        if (Profiler::isRunning())
+            Profiler::enter(declaration->getName().lexeme, declaration->line);
+        if (ExecutionCounters::isEnabled())
+            ExecutionCounters::enterFunction(declaration);
+        if (TraceEvents::isOpen())
+            start = TraceEvents::now();
+    }
+
+    Interpreter::CallGuard::~CallGuard()
+    {
+        if (!active)
+            return;
+        if (Profiler::isRunning())
+            Profiler::leave();
+        if (ExecutionCounters::isEnabled())
+            ExecutionCounters::leaveFunction(declaration);
+        if (TraceEvents::isOpen())
+        {
+            double end = TraceEvents::now();
+            if (end - start >= TraceEvents::getCallThreshold())
+                TraceEvents::complete(declaration->getName().lexeme, "call", start, end, declaration->line);
+        }
+    }
+
 
 }
@@ -34,7 +34,12 @@ namespace Lox
 
   void Lox::ReportRuntimeError(const RuntimeError& error)
   {
-    fmt::print(std::cerr, "[line {}] {}\n", error.getToken().getLine(), error.what());
+    ReportRuntimeError(error.getToken().getLine(), error.what());
+  }
+
+  void Lox::ReportRuntimeError(int line, const std::string& message)
+  {
+    fmt::print(std::cerr, "[line {}] {}\n", line, message);
     HadRuntimeError = true;
   }
 
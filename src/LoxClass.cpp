@@ -1,40 +1,56 @@
 #include "LoxClass.h"
+#include "RunStats.h"
 
 namespace Lox
 {
-    LoxClass::LoxClass(const std::string& name, std::shared_ptr<LoxClass> superclass, std::unordered_map<std::string, std::shared_ptr<LoxFunction>> methods)
-        : name(name), superclass(std::move(superclass)), methods(methods)
-    {}
-
-    std::shared_ptr<LoxFunction> LoxClass::findMethod(const std::string& name) const
+    LoxClass::LoxClass(std::string_view name, Ref<LoxClass> superclass, std::unordered_map<std::string_view, Ref<LoxFunction>> methods)
+        : Callable(ObjectType::CLASS), name(name), superclass(std::move(superclass)), methods(std::move(methods))
     {
-        if (methods.find(name) != methods.end())
-            return methods.at(name);
-
-        if (superclass != nullptr)
+        // The superclass's table is already flattened, so copying in what
+        // this class doesn't override is enough.
+        if (this->superclass != nullptr)
         {
-            return superclass->findMethod(name);
+            this->methods.insert(this->superclass->methods.begin(), this->superclass->methods.end());
         }
 
-        return nullptr;
+        initializer = findMethod("init");
+        if (initializer != nullptr)
+            arity = initializer->getArity();
+    }
+
+    LoxFunction* LoxClass::findMethod(std::string_view name) const
+    {
+        auto it = methods.find(name);
+        return it != methods.end() ? it->second.get() : nullptr;
     }
 
-    std::any LoxClass::call(Interpreter& interpreter, const std::vector<std::any>& arguments) 
+    Value LoxClass::call(Interpreter& interpreter, const std::vector<Value>& arguments) 
     {
-        std::shared_ptr<LoxInstance> instance = std::make_shared<LoxInstance>(std::static_pointer_cast<LoxClass>(shared_from_this()));
-        std::shared_ptr<LoxFunction> initializer = findMethod("init");
+        Ref<LoxInstance> instance = makeRef<LoxInstance>(this);
+        RunStats::current.instances++;
         if (initializer != nullptr)
         {
-            initializer->bind(instance)->call(interpreter, arguments);
+            initializer->callMethod(interpreter, instance, arguments);
         }
         return instance;
     }
     int LoxClass::getArity() 
     {
-        std::shared_ptr<LoxFunction> initializer = findMethod("init");
-        if (initializer == nullptr)
-            return 0;
-        return initializer->getArity();
+        return arity;
+    }
+
+    void LoxClass::trace(Tracer& tracer) const
+    {
+        tracer.visit(superclass);
+        for (const auto& [name, method] : methods)
+            tracer.visit(method);
+    }
+
+    void LoxClass::clearReferences()
+    {
+        superclass = nullptr;
+        methods.clear();
+        initializer = nullptr;
     }
 
     std::string LoxClass::toString()
@@ -4,27 +4,90 @@
 
 #include <utility>
 
+#include <fmt/core.h>
+
 namespace Lox
 {
-    LoxInstance::LoxInstance(const std::shared_ptr<LoxClass>& klass)
-    : klass(klass)
+    LoxInstance::LoxInstance(const Ref<LoxClass>& klass)
+    : Object(ObjectType::INSTANCE), klass(klass), shape(&klass->rootShape)
     {}
 
-    std::any LoxInstance::get(const Token& name)
+    Value LoxInstance::get(const Token& name, InlineCache& cache)
     {
-        if(fields.find(name.lexeme) != fields.end())
-            return fields.at(name.lexeme);
+        Property property = findProperty(name, cache);
+        if (property.field != nullptr)
+            return *property.field;
+        if (property.method != nullptr)
+            return property.method->bind(this);
+
+        throw RuntimeError(name, fmt::format("Undefined property '{}'.", name.lexeme));
+    }
 
-        std::shared_ptr<LoxFunction> method = klass->findMethod(name.lexeme);
+    LoxInstance::Property LoxInstance::findProperty(const Token& name, InlineCache& cache)
+    {
+        if (const InlineCache::Entry* entry = cache.find(shape->getId()))
+        {
+            if (entry->method != nullptr)
+                return {nullptr, entry->method};
+            return {&fields[entry->slot], nullptr};
+        }
+
+        int slot = shape->lookup(name.lexeme);
+        if (slot >= 0)
+        {
+            cache.add({shape->getId(), slot, nullptr, nullptr});
+            return {&fields[slot], nullptr};
+        }
+
+        // Missing properties are not cached; looking one up is an error.
+        LoxFunction* method = klass->findMethod(name.lexeme);
         if (method != nullptr)
-            return method->bind(std::static_pointer_cast<LoxInstance>(shared_from_this()));
+            cache.add({shape->getId(), -1, nullptr, method});
+        return {nullptr, method};
+    }
 
-        throw RuntimeError(name, "Undefined property '" + name.lexeme + "'.");
+    void LoxInstance::set(const Token& name, const Value& value, InlineCache& cache)
+    {
+        if (const InlineCache::Entry* entry = cache.find(shape->getId()))
+        {
+            if (entry->transition)
+            {
+                shape = entry->transition;
+                fields.push_back(value);
+            }
+            else
+            {
+                fields[entry->slot] = value;
+            }
+            return;
+        }
+
+        int slot = shape->lookup(name.lexeme);
+        if (slot >= 0)
+        {
+            cache.add({shape->getId(), slot, nullptr, nullptr});
+            fields[slot] = value;
+            return;
+        }
+
+        // A transition is only followed from the shape it was recorded on,
+        // which owns the target, so the cached pointer cannot dangle.
+        Shape* next = shape->withField(name.lexeme);
+        cache.add({shape->getId(), static_cast<int>(fields.size()), next, nullptr});
+        shape = next;
+        fields.push_back(value);
+    }
+
+    void LoxInstance::trace(Tracer& tracer) const
+    {
+        tracer.visit(klass);
+        for (const Value& field : fields)
+            tracer.visit(field);
     }
 
-    void LoxInstance::set(Token& name, std::any& value)
+    void LoxInstance::clearReferences()
     {
-        fields[name.lexeme] = value;
+        fields.clear();
     }
 
     std::string LoxInstance::toString()
@@ -0,0 +1,254 @@
+#include "Optimizer.h"
+
+#include <algorithm>
+
+namespace Lox
+{
+    namespace
+    {
+        const Value* literalValue(Expr* expr)
+        {
+            auto* literal = dynamic_cast<Literal*>(expr);
+            return literal != nullptr ? &literal->literal : nullptr;
+        }
+    }
+
+    Optimizer::Optimizer(Arena& arena) : arena(arena)
+    {}
+
+    void Optimizer::optimize(std::vector<Stmt*>& statements)
+    {
+        for (Stmt*& stmt : statements)
+            stmt = optimize(stmt);
+        statements.erase(std::remove(statements.begin(), statements.end(), nullptr), statements.end());
+    }
+
+    Stmt* Optimizer::optimize(Stmt* stmt)
+    {
+        return std::any_cast<Stmt*>(stmt->accept(*this));
+    }
+
+    Expr* Optimizer::optimize(Expr* expr)
+    {
+        return std::any_cast<Expr*>(expr->accept(*this));
+    }
+
+    Stmt* Optimizer::optimizeBranch(Stmt* stmt)
+    {
+        Stmt* optimized = optimize(stmt);
+        if (optimized == nullptr)
+            return arena.make<Block>(std::vector<Stmt*>{});
+        return optimized;
+    }
+
+    std::any Optimizer::visit_block_stmt(Block* stmt)
+    {
+        optimize(stmt->stmt);
+        return static_cast<Stmt*>(stmt);
+    }
+
+    std::any Optimizer::visit_class_stmt(Class* stmt)
+    {
+        for (Function* method : stmt->methods)
+            optimize(method->body);
+        return static_cast<Stmt*>(stmt);
+    }
+
+    std::any Optimizer::visit_expression_stmt(Expression* stmt)
+    {
+        stmt->expr = optimize(stmt->expr);
+        return static_cast<Stmt*>(stmt);
+    }
+
+    std::any Optimizer::visit_function_stmt(Function* stmt)
+    {
+        optimize(stmt->body);
+        return static_cast<Stmt*>(stmt);
+    }
+
+    std::any Optimizer::visit_if_stmt(If* stmt)
+    {
+        stmt->condition = optimize(stmt->condition);
+        if (const Value* condition = literalValue(stmt->condition))
+        {
+            if (condition->isTruthy())
+                return optimize(stmt->thenBranch);
+            if (stmt->elseBranch != nullptr)
+                return optimize(stmt->elseBranch);
+            return static_cast<Stmt*>(nullptr);
+        }
+
+        stmt->thenBranch = optimizeBranch(stmt->thenBranch);
+        if (stmt->elseBranch != nullptr)
+            stmt->elseBranch = optimize(stmt->elseBranch);
+        return static_cast<Stmt*>(stmt);
+    }
+
+    std::any Optimizer::visit_print_stmt(Print* stmt)
+    {
+        stmt->expr = optimize(stmt->expr);
+        return static_cast<Stmt*>(stmt);
+    }
+
+    std::any Optimizer::visit_return_stmt(Return* stmt)
+    {
+        if (stmt->value != nullptr)
+            stmt->value = optimize(stmt->value);
+        return static_cast<Stmt*>(stmt);
+    }
+
+    std::any Optimizer::visit_var_stmt(Var* stmt)
+    {
+        if (stmt->initializer != nullptr)
+            stmt->initializer = optimize(stmt->initializer);
+        return static_cast<Stmt*>(stmt);
+    }
+
+    std::any Optimizer::visit_while_stmt(While* stmt)
+    {
+        stmt->condition = optimize(stmt->condition);
+        const Value* condition = literalValue(stmt->condition);
+        if (condition != nullptr && !condition->isTruthy())
+            return static_cast<Stmt*>(nullptr);
+
+        stmt->body = optimizeBranch(stmt->body);
+        return static_cast<Stmt*>(stmt);
+    }
+
+    std::any Optimizer::visit_assign_expr(Assign* expr)
+    {
+        expr->value = optimize(expr->value);
+        return static_cast<Expr*>(expr);
+    }
+
+    std::any Optimizer::visit_literal_expr(Literal* expr)
+    {
+        return static_cast<Expr*>(expr);
+    }
+
+    std::any Optimizer::visit_logical_expr(Logical* expr)
+    {
+        expr->left = optimize(expr->left);
+        expr->right = optimize(expr->right);
+
+        // A literal on the left decides which operand is the result.
+        if (const Value* left = literalValue(expr->left))
+        {
+            bool isOr = expr->op.getType() == TokenType::OR;
+            if (left->isTruthy() == isOr)
+                return expr->left;
+            return expr->right;
+        }
+        return static_cast<Expr*>(expr);
+    }
+
+    std::any Optimizer::visit_set_expr(Set* expr)
+    {
+        expr->object = optimize(expr->object);
+        expr->value = optimize(expr->value);
+        return static_cast<Expr*>(expr);
+    }
+
+    std::any Optimizer::visit_super_expr(Super* expr)
+    {
+        return static_cast<Expr*>(expr);
+    }
+
+    std::any Optimizer::visit_this_expr(This* expr)
+    {
+        return static_cast<Expr*>(expr);
+    }
+
+    std::any Optimizer::visit_grouping_expr(Grouping* expr)
+    {
+        return optimize(expr->expr);
+    }
+
+    std::any Optimizer::visit_unary_expr(Unary* expr)
+    {
+        expr->right = optimize(expr->right);
+
+        const Value* right = literalValue(expr->right);
+        if (right == nullptr)
+            return static_cast<Expr*>(expr);
+
+        switch (expr->op.getType())
+        {
+            case TokenType::MINUS:
+                if (right->isNumber())
+                    return static_cast<Expr*>(arena.make<Literal>(-right->asNumber()));
+                break;
+            case TokenType::BANG:
+                return static_cast<Expr*>(arena.make<Literal>(!right->isTruthy()));
+            default:
+                break;
+        }
+        return static_cast<Expr*>(expr);
+    }
+
+    std::any Optimizer::visit_variable_expr(Variable* expr)
+    {
+        return static_cast<Expr*>(expr);
+    }
+
+    std::any Optimizer::visit_binary_expr(Binary* expr)
+    {
+        expr->left = optimize(expr->left);
+        expr->right = optimize(expr->right);
+
+        const Value* left = literalValue(expr->left);
+        const Value* right = literalValue(expr->right);
+        if (left == nullptr || right == nullptr)
+            return static_cast<Expr*>(expr);
+
+        // Must give exactly what Interpreter::visit_binary_expr would.
+        Value result;
+        bool numbers = left->isNumber() && right->isNumber();
+        switch (expr->op.getType())
+        {
+            case TokenType::BANG_EQUAL: result = *left != *right; break;
+            case TokenType::EQUAL_EQUAL: result = *left == *right; break;
+            case TokenType::PLUS:
+                if (numbers)
+                    result = left->asNumber() + right->asNumber();
+                else if (left->isString() && right->isString())
+                    result = concatenate(*left->asString(), *right->asString());
+                else
+                    return static_cast<Expr*>(expr);
+                break;
+            default:
+            {
+                if (!numbers)
+                    return static_cast<Expr*>(expr);
+                double a = left->asNumber();
+                double b = right->asNumber();
+                switch (expr->op.getType())
+                {
+                    case TokenType::GREATER: result = a > b; break;
+                    case TokenType::GREATER_EQUAL: result = a >= b; break;
+                    case TokenType::LESS: result = a < b; break;
+                    case TokenType::LESS_EQUAL: result = a <= b; break;
+                    case TokenType::MINUS: result = a - b; break;
+                    case TokenType::SLASH: result = a / b; break;
+                    case TokenType::STAR: result = a * b; break;
+                    default: return static_cast<Expr*>(expr);
+                }
+            }
+        }
+        return static_cast<Expr*>(arena.make<Literal>(std::move(result)));
+    }
+
+    std::any Optimizer::visit_call_expr(Call* expr)
+    {
+        expr->callee = optimize(expr->callee);
+        for (Expr*& argument : expr->arguments)
+            argument = optimize(argument);
+        return static_cast<Expr*>(expr);
+    }
+
+    std::any Optimizer::visit_get_expr(Get* expr)
+    {
+        expr->object = optimize(expr->object);
+        return static_cast<Expr*>(expr);
+    }
+}
@@ -1,6 +1,9 @@
 #include "Parser.h"
 
 #include "Lox.h"
+#include "RunStats.h"
+
+#include <utility>
 
 #include <fmt/core.h>
 
@@ -9,37 +12,44 @@
 namespace Lox 
 {
 
-    Parser::Parser(std::vector<Token> tokens)
-        :tokens(tokens) 
+    Parser::Parser(std::vector<Token> tokens, Arena& arena)
+        :tokens(std::move(tokens)), arena(arena) 
     {}
 
-    std::vector<std::shared_ptr<Stmt>> Parser::parse()
+    std::vector<Stmt*> Parser::parse()
     {
         // program → declaration * "EOF" ;
-        std::vector<std::shared_ptr<Stmt>> statements;
+        const std::size_t nodes = arena.size();
+        std::vector<Stmt*> statements;
         while(!isAtEnd())
         {
             statements.push_back(declaration());
         }
 
+        RunStats::current.astNodes += arena.size() - nodes;
         return statements;
     }
 
-    std::shared_ptr<Stmt> Parser::declaration()
+    Stmt* Parser::declaration()
     {
       // declaration → varDecl | funDecl | statement ;
       try {
+        const int line = peek().getLine();
+        Stmt* stmt = nullptr;
         if(match(TokenType::CLASS))
             // classDecl → "class" IDENTIFIER ;
-            return classDeclaration();
-        if(match(TokenType::FUN))
+            stmt = classDeclaration();
+        else if(match(TokenType::FUN))
             // funDecl → "fun" function ;
-            return function("function");
-        if(match(TokenType::VAR))
+            stmt = function("function");
+        else if(match(TokenType::VAR))
             // varDecl → "var" varDeclaration;
-            return varDeclaration();
+            stmt = varDeclaration();
+        else
+            return statement();
 
-        return statement();
+        stmt->line = line;
+        return stmt;
       } catch(ParseError error)
       {
         synchronize();
@@ -47,21 +57,21 @@ namespace Lox
       }
     }
 
-    std::shared_ptr<Stmt> Parser::classDeclaration()
+    Stmt* Parser::classDeclaration()
     {
 
         //classDecl → "class" IDENTIFIER ("<" IDENTIFIER)? "{" function* "}" ;
-        Token name = consume(TokenType::IDENTIFIER, "Expect class name.");
+        const Token& name = consume(TokenType::IDENTIFIER, "Expect class name.");
 
-        std::shared_ptr<Variable> superclass;
+        Variable* superclass = nullptr;
         if (match(TokenType::LESS))
         {
             consume(TokenType::IDENTIFIER, "Expect superclass name.");
-            superclass = std::make_shared<Variable>(previous());
+            superclass = arena.make<Variable>(previous());
         }
         consume(TokenType::LEFT_BRACE, "Expect '{' before class body.");
 
-        std::vector<std::shared_ptr<Function>> methods;
+        std::vector<Function*> methods;
         while(!check(TokenType::RIGHT_BRACE) && !isAtEnd())
         {
             methods.push_back(function("method"));
@@ -69,10 +79,10 @@ namespace Lox
 
         consume(TokenType::RIGHT_BRACE, "Expect '}' after class body.");
 
-        return std::make_shared<Class>(name, superclass, methods);
+        return arena.make<Class>(name, superclass, methods);
     }
 
-    std::shared_ptr<Stmt> Parser::statement()
+    Stmt* Parser::statement()
     {
         // statement → ifStmt 
         //             | forStatement
@@ -81,30 +91,35 @@ namespace Lox
         //             | whileStatement
         //             | block 
         //             | returnStmt ;
+        const int line = peek().getLine();
+        Stmt* stmt = nullptr;
         if (match(TokenType::IF))
-            return ifStatement();
-        if (match(TokenType::FOR))
-            return forStatement();
-        if (match(TokenType::PRINT))
-            return printStatement();
-        if (match(TokenType::RETURN))
-            return returnStatement();
-        if (match(TokenType::WHILE))
-            return whileStatement();
-        if (match(TokenType::LEFT_BRACE))
-            return std::make_shared<Block>(std::move(block()));
-
-        return exprStatement();
-    }
-
-    std::shared_ptr<Stmt> Parser::forStatement()
+            stmt = ifStatement();
+        else if (match(TokenType::FOR))
+            stmt = forStatement();
+        else if (match(TokenType::PRINT))
+            stmt = printStatement();
+        else if (match(TokenType::RETURN))
+            stmt = returnStatement();
+        else if (match(TokenType::WHILE))
+            stmt = whileStatement();
+        else if (match(TokenType::LEFT_BRACE))
+            stmt = arena.make<Block>(block());
+        else
+            stmt = exprStatement();
+
+        stmt->line = line;
+        return stmt;
+    }
+
+    Stmt* Parser::forStatement()
     {
         //forStmt → "for" "(" ( varDecl | exprStmt | ";" )
         //          expression? ";"
         //          expression? ")" statement ;
         consume(TokenType::LEFT_PAREN, "Expect '(' after 'for'.");
 
-        std::shared_ptr<Stmt> initializer;
+        Stmt* initializer = nullptr;
         if (match(TokenType::SEMICOLON)) {
             initializer = nullptr;
         } else if(match(TokenType::VAR))
@@ -115,98 +130,98 @@ namespace Lox
             initializer = exprStatement();
         }
 
-        std::shared_ptr<Expr> condition;
+        Expr* condition = nullptr;
         if (!check(TokenType::SEMICOLON)) 
         {
             condition = expression();
         }
         consume(TokenType::SEMICOLON, "Expect ';' after loop condition.");
 
-        std::shared_ptr<Expr> increment;
+        Expr* increment = nullptr;
         if (!check(TokenType::RIGHT_PAREN))
         {
             increment = expression();
         }
         consume(TokenType::RIGHT_PAREN, "Expect ')' after clauses.");
 
-        std::shared_ptr<Stmt> body = statement();
+        Stmt* body = statement();
 
         if (increment)
         {
-            std::vector<std::shared_ptr<Stmt>> statements;
-            statements.push_back(std::move(body));
-            statements.push_back(std::make_shared<Expression>(std::move(increment)));
-            body = std::make_shared<Block>(std::move(statements));
+            std::vector<Stmt*> statements;
+            statements.push_back(body);
+            statements.push_back(arena.make<Expression>(increment));
+            body = arena.make<Block>(std::move(statements));
         }
 
         if (!condition)
-            condition = std::make_shared<Literal>(true);
-        body = std::make_shared<While>(std::move(condition), std::move(body));
+            condition = arena.make<Literal>(true);
+        body = arena.make<While>(condition, body);
 
         if(initializer)
         {
-            std::vector<std::shared_ptr<Stmt>> statements;
-            statements.push_back(std::move(initializer));
-            statements.push_back(std::move(body));
-            body = std::make_shared<Block>(std::move(statements));
+            std::vector<Stmt*> statements;
+            statements.push_back(initializer);
+            statements.push_back(body);
+            body = arena.make<Block>(std::move(statements));
         }
 
         return body;
     }
 
-    std::shared_ptr<Stmt> Parser::ifStatement()
+    Stmt* Parser::ifStatement()
     {
         // ifStmt → "if" "(" expression ")" statement ( "else" statement )? ;
         consume(TokenType::LEFT_PAREN, "Expect '(' after 'if'.");
-        std::shared_ptr<Expr> condition = expression();
+        Expr* condition = expression();
         consume(TokenType::RIGHT_PAREN, "Expect '(' after if condition.");
 
-        std::shared_ptr<Stmt> thenBranch = statement();
-        std::shared_ptr<Stmt> elseBranch = nullptr;
+        Stmt* thenBranch = statement();
+        Stmt* elseBranch = nullptr;
         if(match(TokenType::ELSE))
             elseBranch = statement();
 
-        return std::make_shared<If>(std::move(condition), std::move(thenBranch), std::move(elseBranch));
+        return arena.make<If>(condition, thenBranch, elseBranch);
     }
 
-    std::shared_ptr<Stmt> Parser::printStatement()
+    Stmt* Parser::printStatement()
     {
         // printStatement → "print" expression ";" ;
-        std::shared_ptr<Expr> value = expression();
+        Expr* value = expression();
         consume(TokenType::SEMICOLON, "Expect ';' after value.");
-        return std::make_shared<Print>(std::move(value));
+        return arena.make<Print>(value);
     }
 
-    std::shared_ptr<Stmt> Parser::returnStatement()
+    Stmt* Parser::returnStatement()
     {
         // returnStmt → "return" expression? ";" ;
-        Token keyword = previous();
-        std::shared_ptr<Expr> value;
+        const Token& keyword = previous();
+        Expr* value = nullptr;
         if(!check(TokenType::SEMICOLON))
         {
             value = expression();
         }
 
         consume(TokenType::SEMICOLON, "Expet ';' after return value");
-        return std::make_shared<Return>(keyword, std::move(value));
+        return arena.make<Return>(keyword, value);
     }
 
-    std::shared_ptr<Stmt> Parser::exprStatement()
+    Stmt* Parser::exprStatement()
     {
         // exprStatement → expression ";" ;
-        std::shared_ptr<Expr> expr = expression();
+        Expr* expr = expression();
         consume(TokenType::SEMICOLON, "Expect ';' after expression.");
-        return std::make_shared<Expression>(std::move(expr));
+        return arena.make<Expression>(expr);
     }
     
-    std::shared_ptr<Function> Parser::function(std::string kind) 
+    Function* Parser::function(std::string kind) 
     {
         // function → IDENTIFIER "(" parameters? ")" block ;
         static const auto errNameMissing = fmt::format("Expect {} name.", kind);
         static const auto errLParenMissing = fmt::format("Expect '(' after {} name.", kind);
         static const auto errLBraceMissing = fmt::format("Expect '{{' before {} body.", kind);
 
-        Token name = consume(TokenType::IDENTIFIER, errNameMissing.c_str());
+        const Token& name = consume(TokenType::IDENTIFIER, errNameMissing.c_str());
         consume(TokenType::LEFT_PAREN, errLParenMissing.c_str());
 
         std::vector<Token> parameters;
@@ -226,15 +241,17 @@ namespace Lox
         consume(TokenType::RIGHT_PAREN, "Expect ')' after parameters.");
 
         consume(TokenType::LEFT_BRACE, errLBraceMissing.c_str());
-        std::vector<std::shared_ptr<Stmt>> body = block();
+        std::vector<Stmt*> body = block();
 
-        return std::make_shared<Function>(name, std::move(parameters), std::move(body)); 
+        Function* declaration = arena.make<Function>(name, std::move(parameters), std::move(body));
+        declaration->line = name.getLine();
+        return declaration;
     }
 
-    std::vector<std::shared_ptr<Stmt>> Parser::block()
+    std::vector<Stmt*> Parser::block()
     {
       // block → "{" declaration* "}" ;
-      std::vector<std::shared_ptr<Stmt>> statements;
+      std::vector<Stmt*> statements;
 
       while(!check(TokenType::RIGHT_BRACE) && !isAtEnd())
       {
@@ -245,54 +262,54 @@ namespace Lox
       return statements;
     }
 
-    std::shared_ptr<Stmt> Parser::varDeclaration()
+    Stmt* Parser::varDeclaration()
     {
       // varDeclaration → IDENTIFIER ("=" expression)? ";" ;
-      Token name = consume(TokenType::IDENTIFIER, "Expect variable name.");
+      const Token& name = consume(TokenType::IDENTIFIER, "Expect variable name.");
 
-      std::shared_ptr<Expr> initializer = nullptr;
+      Expr* initializer = nullptr;
 
       if(match(TokenType::EQUAL))
         initializer = expression();
 
       consume(TokenType::SEMICOLON, "Expect ';' after variable declaration.");
-      return std::make_shared<Var>(name, std::move(initializer));
+      return arena.make<Var>(name, initializer);
     }
 
-    std::shared_ptr<Stmt> Parser::whileStatement()
+    Stmt* Parser::whileStatement()
     {
         // whileStmt → "while" "(" expression ")" statement ;
         consume(TokenType::LEFT_PAREN, "Expect '(' after 'while'.");
-        std::shared_ptr<Expr> condition = expression();
+        Expr* condition = expression();
         consume(TokenType::RIGHT_PAREN, "Expect ')' after condition.");
-        std::shared_ptr<Stmt> body = statement();
+        Stmt* body = statement();
 
-        return std::make_shared<While>(std::move(condition), std::move(body));
+        return arena.make<While>(condition, body);
     }
 
-    std::shared_ptr<Expr> Parser::expression()
+    Expr* Parser::expression()
     {
         // expression → assignment ;
         return assignment();
     }
 
-    std::shared_ptr<Expr> Parser::assignment()
+    Expr* Parser::assignment()
     {
         // assignment → (call ".")? IDENTIFIER "=" assignment | logic_or ;
       auto expr = logicalOr();
 
       if(match(TokenType::EQUAL))
       {
-        auto equals = previous();
+        const Token& equals = previous();
         auto value = assignment();
         //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
         // Uh oh...
-        if(const auto* varExpr = dynamic_cast<Variable*>(expr.get()); varExpr)
+        if(const auto* varExpr = dynamic_cast<Variable*>(expr); varExpr)
         {
-          return std::make_shared<Assign>(varExpr->name, std::move(value));
-        } else if (const auto* getExpr = dynamic_cast<Get*>(expr.get()); getExpr)
+          return arena.make<Assign>(varExpr->name, value);
+        } else if (const auto* getExpr = dynamic_cast<Get*>(expr); getExpr)
         {
-            return std::make_shared<Set>(getExpr->object, getExpr->name, value);
+            return arena.make<Set>(getExpr->object, getExpr->name, value);
         }
 
         error(equals, "Invalid assignment target.");
@@ -301,112 +318,112 @@ namespace Lox
       return expr;
     }
 
-    std::shared_ptr<Expr> Parser::logicalOr()
+    Expr* Parser::logicalOr()
     {
         // logic_or → logic_and ( "or" logic_and )* ;
-        std::shared_ptr<Expr> expr = logicalAnd();
+        Expr* expr = logicalAnd();
 
         while(match(TokenType::OR))
         {
-            Token op  = previous();
-            std::shared_ptr<Expr> right = logicalAnd();
-            expr = std::make_shared<Logical>(std::move(expr), op, std::move(right)); 
+            const Token& op = previous();
+            Expr* right = logicalAnd();
+            expr = arena.make<Logical>(expr, op, right); 
         }
         return expr;
     }
 
-    std::shared_ptr<Expr> Parser::logicalAnd()
+    Expr* Parser::logicalAnd()
     {
         // logic_and → equality ( "and" equality )* ;
-        std::shared_ptr<Expr> expr = equality();
+        Expr* expr = equality();
 
         while(match(TokenType::AND))
         {
-            Token op = previous();
-            std::shared_ptr<Expr> right = equality();
-            expr = std::make_shared<Logical>(std::move(expr), op, std::move(right));
+            const Token& op = previous();
+            Expr* right = equality();
+            expr = arena.make<Logical>(expr, op, right);
         }
 
         return expr;
     }
 
-    std::shared_ptr<Expr> Parser::equality()
+    Expr* Parser::equality()
     {
         // equality → comparison ( ( "!=" | "==" ) comparison )* ;
-        std::shared_ptr<Expr> expr = comparison();
+        Expr* expr = comparison();
 
         while(match(TokenType::BANG_EQUAL, TokenType::EQUAL_EQUAL))
         {
-            Token op = previous();
-            std::shared_ptr<Expr> right = comparison();
-            expr = std::make_shared<Binary>(std::move(expr), op, std::move(right));
+            const Token& op = previous();
+            Expr* right = comparison();
+            expr = arena.make<Binary>(expr, op, right);
         }
 
         return expr;
     }
     
-    std::shared_ptr<Expr> Parser::comparison()
+    Expr* Parser::comparison()
     {
         //comparison → term ( ( ">" | ">=" | "<" | "<=" ) term )* ;
-        std::shared_ptr<Expr> expr = term();
+        Expr* expr = term();
 
         while(match(TokenType::GREATER, TokenType::GREATER_EQUAL, TokenType::LESS, TokenType::LESS_EQUAL))
         {
-            Token op = previous();
-            std::shared_ptr<Expr> right = term();
-            expr = std::make_shared<Binary>(std::move(expr), op, std::move(right));
+            const Token& op = previous();
+            Expr* right = term();
+            expr = arena.make<Binary>(expr, op, right);
         }
 
         return expr;
     }
 
-    std::shared_ptr<Expr> Parser::term()
+    Expr* Parser::term()
     {
         // term → factor ( ( "-" | "+" ) factor )* ;
-        std::shared_ptr<Expr> expr = factor();
+        Expr* expr = factor();
 
         while(match(TokenType::MINUS, TokenType::PLUS))
         {
-            Token op = previous();
-            std::shared_ptr<Expr> right = factor();
-            expr = std::make_shared<Binary>(std::move(expr), op, std::move(right));
+            const Token& op = previous();
+            Expr* right = factor();
+            expr = arena.make<Binary>(expr, op, right);
         }
 
         return expr;
     }
 
-    std::shared_ptr<Expr> Parser::factor()
+    Expr* Parser::factor()
     {
         // factor → unary ( ( "/" | "*" ) unary )* ;
-        std::shared_ptr<Expr> expr = unary();
+        Expr* expr = unary();
 
         while(match(TokenType::SLASH, TokenType::STAR))
         {
-            Token op = previous();
-            std::shared_ptr<Expr> right = unary();
-            expr = std::make_shared<Binary>(std::move(expr), op, std::move(right));
+            const Token& op = previous();
+            Expr* right = unary();
+            expr = arena.make<Binary>(expr, op, right);
         }
 
         return expr;
     }
 
-    std::shared_ptr<Expr> Parser::unary() 
+    Expr* Parser::unary() 
     {
         // unary → ( "!" | "-" ) unary | call ;
         if(match(TokenType::BANG, TokenType::MINUS))
         {
-            Token op = previous();
-            std::shared_ptr<Expr> right = unary();
-            return std::make_shared<Unary>(op, std::move(right)); 
+            const Token& op = previous();
+            Expr* right = unary();
+            return arena.make<Unary>(op, right); 
         }
         return call();
     }
 
-    std::shared_ptr<Expr> Parser::call()
+    Expr* Parser::call()
     {
         // call → primary ( "(" arguments? ")" | "." IDENTIFIER )* ;
         // arguments → expression ( "," expression )* ;
-        std::shared_ptr<Expr> expr = primary();
+        Expr* expr = primary();
 
         while(true)
         {
@@ -415,8 +432,8 @@ namespace Lox
                 expr = finishCall(expr);
             } else if (match(TokenType::DOT))
             {
-                Token name = consume(TokenType::IDENTIFIER, "Expect property name after '.'.");
-                expr = std::make_shared<Get>(expr, name);
+                const Token& name = consume(TokenType::IDENTIFIER, "Expect property name after '.'.");
+                expr = arena.make<Get>(expr, name);
             } 
             else 
             {
@@ -426,57 +443,61 @@ namespace Lox
         return expr;
     }
 
-    std::shared_ptr<Expr> Parser::primary()
+    Expr* Parser::primary()
     {
         //primary        → "true" | "false" | "nil" | "this"
         //       | NUMBER | STRING | IDENTIFIER | "(" expression ")"
         //       | "super" "." IDENTIFIER ;
         if(match(TokenType::FALSE))
         {
-            return std::make_shared<Literal>(false);
+            return arena.make<Literal>(false);
         }
         if(match(TokenType::TRUE))
         {
-            return std::make_shared<Literal>(true);
+            return arena.make<Literal>(true);
         }
         if(match(TokenType::NIL))
         {
-            return std::make_shared<Literal>(std::any{});
+            return arena.make<Literal>(Value{});
+        }
+        if(match(TokenType::NUMBER))
+        {
+            return arena.make<Literal>(std::get<double>(previous().literal));
         }
-        if(match(TokenType::NUMBER, TokenType::STRING))
+        if(match(TokenType::STRING))
         {
-            return std::make_shared<Literal>(previous().literal);
+            return arena.make<Literal>(makeRef<LoxString>(std::string(std::get<std::string_view>(previous().literal))));
         }
         if(match(TokenType::SUPER))
         {
-            Token keyword = previous();
+            const Token& keyword = previous();
             consume(TokenType::DOT, "Expect '.' after 'super'.");
-            Token method = consume(TokenType::IDENTIFIER, "Expect superclass method name");
-            return std::make_shared<Super>(keyword, method);
+            const Token& method = consume(TokenType::IDENTIFIER, "Expect superclass method name");
+            return arena.make<Super>(keyword, method);
         }
         if(match(TokenType::THIS))
         {
-            return std::make_shared<This>(previous());
+            return arena.make<This>(previous());
         }
 
         if(match(TokenType::IDENTIFIER))
         {
-          return std::make_shared<Variable>(previous());
+          return arena.make<Variable>(previous());
         }
 
         if(match(TokenType::LEFT_PAREN))
         {
-            std::shared_ptr<Expr> expr = expression();
+            Expr* expr = expression();
             consume(TokenType::RIGHT_PAREN, "Expect ')' after expression.");
-            return std::make_shared<Grouping>(std::move(expr));
+            return arena.make<Grouping>(expr);
         }
 
         throw error(peek(), "Expect expression.");
     }
 
-    std::shared_ptr<Expr> Parser::finishCall(std::shared_ptr<Expr>& callee) 
+    Expr* Parser::finishCall(Expr* callee) 
     {
-        std::vector<std::shared_ptr<Expr>> arguments;
+        std::vector<Expr*> arguments;
         if(!check(TokenType::RIGHT_PAREN))
         {
             do {
@@ -488,9 +509,11 @@ namespace Lox
             } while (match(TokenType::COMMA));
         }
 
-        Token paren = consume(TokenType::RIGHT_PAREN, "Expect ')' after arguments.");
+        const Token& paren = consume(TokenType::RIGHT_PAREN, "Expect ')' after arguments.");
 
-        return std::make_shared<Call>(std::move(callee), paren, std::move(arguments));
+        Call* call = arena.make<Call>(callee, paren, std::move(arguments));
+        call->method = dynamic_cast<Get*>(callee);
+        return call;
     }
 
     bool Parser::check(TokenType type) const
@@ -500,7 +523,7 @@ namespace Lox
         return peek().getType() == type;
     }
 
-    Token Parser::advance()
+    const Token& Parser::advance()
     {
         if (!isAtEnd())
             current++;
@@ -512,14 +535,14 @@ namespace Lox
         return peek().getType() == TokenType::TokenEOF;
     }
 
-    Token Parser::peek() const 
+    const Token& Parser::peek() const 
     {
-        return tokens.at(current);
+        return tokens[current];
     }
 
-    Token Parser::previous() const
+    const Token& Parser::previous() const
     {
-        return tokens.at(current - 1);
+        return tokens[current - 1];
     }
 
     void Parser::synchronize()
@@ -548,7 +571,7 @@ namespace Lox
         }
     }
 
-    Token Parser::consume(TokenType type, const char* message)
+    const Token& Parser::consume(TokenType type, const char* message)
     {
         if(check(type)) 
             return advance();
@@ -556,7 +579,7 @@ namespace Lox
         throw error(peek(), message);
     }
 
-    Parser::ParseError Parser::error(Token token, const char* message) const
+    Parser::ParseError Parser::error(const Token& token, const char* message) const
     {
         Lox::Error(token, message);
         return ParseError{};
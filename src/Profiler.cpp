@@ -0,0 +1,100 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+
+#include <fmt/format.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define LOX_HAVE_ITIMER 1
+#include <sys/time.h>
+#endif
+
+namespace Lox
+{
+    bool Profiler::running = false;
+    volatile std::sig_atomic_t Profiler::ticks = 0;
+    std::vector<Profiler::Frame> Profiler::stack;
+    std::unordered_map<std::string, std::size_t> Profiler::samples;
+
+    bool Profiler::start(int frequency)
+    {
+#ifdef LOX_HAVE_ITIMER
+        struct sigaction action = {};
+        action.sa_handler = &Profiler::onTick;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        if (sigaction(SIGPROF, &action, nullptr) != 0)
+            return false;
+
+        // ITIMER_PROF counts the CPU time the process uses, so time blocked
+        // on output is not sampled.
+        long interval = std::max(1000000L / std::max(frequency, 1), 1L);
+        itimerval timer = {};
+        timer.it_interval.tv_sec = interval / 1000000;
+        timer.it_interval.tv_usec = interval % 1000000;
+        timer.it_value = timer.it_interval;
+        if (setitimer(ITIMER_PROF, &timer, nullptr) != 0)
+            return false;
+
+        stack.push_back({"<script>", 0});
+        running = true;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void Profiler::stop()
+    {
+        if (!running)
+            return;
+#ifdef LOX_HAVE_ITIMER
+        itimerval timer = {};
+        setitimer(ITIMER_PROF, &timer, nullptr);
+#endif
+        poll();
+        running = false;
+    }
+
+    bool Profiler::write(const std::string& path)
+    {
+        std::FILE* file = std::fopen(path.c_str(), "w");
+        if (file == nullptr)
+            return false;
+
+        // Sorted so the output of two runs can be diffed.
+        std::vector<std::pair<std::string_view, std::size_t>> lines(samples.begin(), samples.end());
+        std::sort(lines.begin(), lines.end());
+        for (const auto& [stack, count] : lines)
+            fmt::print(file, "{} {}\n", stack, count);
+        return std::fclose(file) == 0;
+    }
+
+    void Profiler::enter(std::string_view function, int line)
+    {
+        poll();
+        stack.push_back({function, line});
+    }
+
+    void Profiler::sample()
+    {
+        std::size_t count = static_cast<std::size_t>(ticks);
+        ticks = 0;
+
+        fmt::memory_buffer key;
+        for (const Frame& frame : stack)
+        {
+            if (key.size() != 0)
+                key.push_back(';');
+            fmt::format_to(std::back_inserter(key), "{}:{}", frame.function, frame.line);
+        }
+        samples[fmt::to_string(key)] += count;
+    }
+
+    void Profiler::onTick(int)
+    {
+        ticks = ticks + 1;
+    }
+}
@@ -2,17 +2,13 @@
 
 namespace Lox
 {
-    Resolver::Resolver(Interpreter& interpreter)
-        : interpreter(interpreter)
-    {}
-
-    std::any Resolver::visit_expression_stmt(std::shared_ptr<Expression> stmt)
+    std::any Resolver::visit_expression_stmt(Expression* stmt)
     {
         resolve(stmt->expr);
         return {};
     }
 
-    std::any Resolver::visit_if_stmt(std::shared_ptr<If> stmt)
+    std::any Resolver::visit_if_stmt(If* stmt)
     {
         resolve(stmt->condition);
         resolve(stmt->thenBranch);
@@ -20,13 +16,13 @@ namespace Lox
         return {};
     }
 
-    std::any Resolver::visit_print_stmt(std::shared_ptr<Print> stmt)
+    std::any Resolver::visit_print_stmt(Print* stmt)
     {
         resolve(stmt->expr);
         return {};
     }
 
-    std::any Resolver::visit_return_stmt(std::shared_ptr<Return> stmt)
+    std::any Resolver::visit_return_stmt(Return* stmt)
     {
         if (currentFunction == FNONE)
         {
@@ -44,21 +40,21 @@ namespace Lox
         return {};
     } 
 
-    std::any Resolver::visit_while_stmt(std::shared_ptr<While> stmt)
+    std::any Resolver::visit_while_stmt(While* stmt)
     {
         resolve(stmt->condition);
         resolve(stmt->body);
         return {};
     }
 
-    std::any Resolver::visit_binary_expr(std::shared_ptr<Binary> expr)
+    std::any Resolver::visit_binary_expr(Binary* expr)
     {
         resolve(expr->left);
         resolve(expr->right);
         return {};
     }
 
-    std::any Resolver::visit_call_expr(std::shared_ptr<Call> expr)
+    std::any Resolver::visit_call_expr(Call* expr)
     {
         resolve(expr->callee);
 
@@ -70,13 +66,13 @@ namespace Lox
         return {};
     }
 
-    std::any Resolver::visit_get_expr(std::shared_ptr<Get> expr)
+    std::any Resolver::visit_get_expr(Get* expr)
     {
         resolve(expr->object);
         return {};
     }
 
-    std::any Resolver::visit_block_stmt(std::shared_ptr<Block> stmt)
+    std::any Resolver::visit_block_stmt(Block* stmt)
     {
         beginScope();
         resolve(stmt->stmt);
@@ -84,7 +80,7 @@ namespace Lox
         return {};
     }
 
-    std::any Resolver::visit_class_stmt(std::shared_ptr<Class> stmt)
+    std::any Resolver::visit_class_stmt(Class* stmt)
     {
         ClassType enclosingClass = currentClass;
         currentClass = ClassType::CLASS;
@@ -104,12 +100,9 @@ namespace Lox
         if (stmt->superclass != nullptr)
         {
             beginScope();
-            scopes.back()["super"] = true;
+            defineImplicit("super");
         }
 
-        beginScope();
-        scopes.back()["this"] = true;
-
         for (auto& method : stmt->methods)
         {
             FunctionType declaration = FunctionType::METHOD;
@@ -120,8 +113,6 @@ namespace Lox
             resolveFunction(method, declaration);
         }
 
-        endScope();
-
         if (stmt->superclass != nullptr)
             endScope();
 
@@ -129,32 +120,32 @@ namespace Lox
         return {};
     }
 
-    std::any Resolver::visit_grouping_expr(std::shared_ptr<Grouping> expr)
+    std::any Resolver::visit_grouping_expr(Grouping* expr)
     {
         resolve(expr->expr);
         return {};
     }
 
-    std::any Resolver::visit_literal_expr(std::shared_ptr<Literal> expr)
+    std::any Resolver::visit_literal_expr(Literal* expr)
     {
         return {};
     }
 
-    std::any  Resolver::visit_logical_expr(std::shared_ptr<Logical> expr)
+    std::any  Resolver::visit_logical_expr(Logical* expr)
     {
         resolve(expr->left);
         resolve(expr->right);
         return {};
     }
 
-    std::any Resolver::visit_set_expr(std::shared_ptr<Set> expr)
+    std::any Resolver::visit_set_expr(Set* expr)
     {
         resolve(expr->value);
         resolve(expr->object);
         return {};
     }    
 
-    std::any Resolver::visit_super_expr(std::shared_ptr<Super> expr)
+    std::any Resolver::visit_super_expr(Super* expr)
     {
         if (currentClass == ClassType::CNONE)
         {
@@ -164,28 +155,28 @@ namespace Lox
             Lox::Error(expr->keyword, "Can't use 'super' in a class with no superclass.");
         }
         
-        resolveLocal(expr, expr->keyword);
+        resolveLocal(expr->resolved, expr->keyword);
         return {};
     }
 
-    std::any Resolver::visit_this_expr(std::shared_ptr<This> expr)
+    std::any Resolver::visit_this_expr(This* expr)
     {
         if (currentClass == ClassType::CNONE)
         {
             Lox::Error(expr->keyword, "Can't use 'this' outside of a class.");
             return {};
         }
-        resolveLocal(expr, expr->keyword);
+        resolveLocal(expr->resolved, expr->keyword);
         return {};
     }
 
-    std::any Resolver::visit_unary_expr(std::shared_ptr<Unary> expr)
+    std::any Resolver::visit_unary_expr(Unary* expr)
     {
         resolve(expr->right);
         return {};
     }
 
-    std::any Resolver::visit_var_stmt(std::shared_ptr<Var> stmt) 
+    std::any Resolver::visit_var_stmt(Var* stmt) 
     {
         declare(stmt->getName());
         if(stmt->initializer != nullptr)
@@ -196,26 +187,29 @@ namespace Lox
         return {};
     }
     
-    std::any Resolver::visit_variable_expr(std::shared_ptr<Variable> expr)
+    std::any Resolver::visit_variable_expr(Variable* expr)
     {
-        if(!scopes.empty() &&
-            scopes.back().find(expr->getName().lexeme) != scopes.back().end() && !scopes.back()[expr->getName().lexeme])
+        if(!scopes.empty())
         {
-            Lox::Error(expr->getName(), "Can't read local variable in its own initializer.");
+            auto it = scopes.back().find(expr->getName().lexeme);
+            if(it != scopes.back().end() && !it->second.defined)
+            {
+                Lox::Error(expr->getName(), "Can't read local variable in its own initializer.");
+            }
         }
 
-        resolveLocal(expr, expr->getName());
+        resolveLocal(expr->resolved, expr->getName());
         return {};
     }
 
-    std::any Resolver::visit_assign_expr(std::shared_ptr<Assign> expr)
+    std::any Resolver::visit_assign_expr(Assign* expr)
     {
         resolve(expr->value);
-        resolveLocal(expr, expr->name);
+        resolveLocal(expr->resolved, expr->name);
         return {};
     }
 
-    std::any Resolver::visit_function_stmt(std::shared_ptr<Function> stmt) 
+    std::any Resolver::visit_function_stmt(Function* stmt) 
     {
         declare(stmt->name);
         define(stmt->name);
@@ -224,27 +218,33 @@ namespace Lox
         return {};
     }
 
-    void Resolver::resolve(const std::vector<std::shared_ptr<Stmt>>& statements)
+    void Resolver::resolve(const std::vector<Stmt*>& statements)
     {
         for (auto& statement : statements)
         {
             resolve(statement);
         }
     }
-    void Resolver::resolve(const std::shared_ptr<Stmt>& stmt)
+    void Resolver::resolve(Stmt* stmt)
     {
         stmt->accept(*this);
     }
-    void Resolver::resolve(const std::shared_ptr<Expr>& expr)
+    void Resolver::resolve(Expr* expr)
     {
         expr->accept(*this);
     }
-    void Resolver::resolveFunction(const std::shared_ptr<Function>& function, FunctionType type)
+    void Resolver::resolveFunction(Function* function, FunctionType type)
     {
         FunctionType enclosingFunction = currentFunction;
         currentFunction = type;
 
         beginScope();
+        // Methods find their receiver in the first slot of the call's own
+        // environment rather than in one wrapped around the method.
+        if (type == METHOD || type == INITIALIZER)
+        {
+            defineImplicit("this");
+        }
         for(Token param : function->getParams())
         {
             declare(param);
@@ -266,25 +266,36 @@ namespace Lox
     {
         if(scopes.empty())
             return;
-        if(scopes.back().find(name.lexeme) != scopes.back().end())
+        auto& scope = scopes.back();
+        if(scope.find(name.lexeme) != scope.end())
         {
             Lox::Error(name, "Already a variable with this name in this scope.");
+            return;
         }
-        scopes.back()[name.lexeme] = false;
+        int slot = static_cast<int>(scope.size());
+        scope[name.lexeme] = LocalVariable{false, slot};
     }
     void Resolver::define(const Token& name)
     {
         if(scopes.empty())
             return;
-        scopes.back()[name.lexeme] = true;
+        scopes.back()[name.lexeme].defined = true;
+    }
+    void Resolver::defineImplicit(std::string_view name)
+    {
+        auto& scope = scopes.back();
+        int slot = static_cast<int>(scope.size());
+        scope[name] = LocalVariable{true, slot};
     }
-    void Resolver::resolveLocal(std::shared_ptr<Expr> expr, const Token& name)
+    void Resolver::resolveLocal(ResolvedSlot& resolved, const Token& name)
     {
         for(int i = scopes.size() - 1; i >= 0; i--)
         {
-            if(scopes[i].find(name.lexeme) != scopes[i].end())
+            auto it = scopes[i].find(name.lexeme);
+            if(it != scopes[i].end())
             {
-                interpreter.resolve(expr, scopes.size() - 1 - i);
+                resolved.depth = static_cast<int>(scopes.size()) - 1 - i;
+                resolved.slot = it->second.slot;
                 return;
             }
         }
@@ -0,0 +1,52 @@
+#include "RunStats.h"
+
+#include <fmt/core.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define LOX_HAVE_RUSAGE 1
+#include <sys/resource.h>
+#endif
+
+namespace Lox
+{
+    RunStats RunStats::current;
+
+    namespace
+    {
+        // Peak resident set size in kilobytes, or 0 if unknown.
+        long peakRssKilobytes()
+        {
+#ifdef LOX_HAVE_RUSAGE
+            rusage usage = {};
+            if (getrusage(RUSAGE_SELF, &usage) != 0)
+                return 0;
+#ifdef __APPLE__
+            return usage.ru_maxrss / 1024;
+#else
+            return usage.ru_maxrss;
+#endif
+#else
+            return 0;
+#endif
+        }
+    }
+
+    void RunStats::print(std::FILE* file, bool treeWalker) const
+    {
+        fmt::print(file, "[stats] scan: {:.3f} ms\n", scanSeconds * 1000);
+        fmt::print(file, "[stats] parse: {:.3f} ms\n", parseSeconds * 1000);
+        fmt::print(file, "[stats] resolve: {:.3f} ms\n", resolveSeconds * 1000);
+        fmt::print(file, "[stats] optimize: {:.3f} ms\n", optimizeSeconds * 1000);
+        fmt::print(file, "[stats] interpret: {:.3f} ms\n", interpretSeconds * 1000);
+        fmt::print(file, "[stats] tokens: {}\n", tokens);
+        fmt::print(file, "[stats] AST nodes: {}\n", astNodes);
+        fmt::print(file, "[stats] function calls: {}\n", calls);
+        if (treeWalker)
+            fmt::print(file, "[stats] environments: {}\n", environments);
+        fmt::print(file, "[stats] instances: {}\n", instances);
+        fmt::print(file, "[stats] bound methods: {}\n", boundMethods);
+        if (treeWalker)
+            fmt::print(file, "[stats] returns: {}\n", returns);
+        fmt::print(file, "[stats] peak RSS: {} KB\n", peakRssKilobytes());
+    }
+}
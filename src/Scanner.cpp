@@ -1,32 +1,252 @@
 #include "Scanner.h"
 #include "Lox.h"
-#include <cctype>
+#include "RunStats.h"
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <utility>
 #include <fmt/core.h>
+
+#if defined(__GNUC__) && defined(__AVX2__)
+#include <immintrin.h>
+#define LOX_SCAN_SIMD 1
+#elif defined(__GNUC__) && defined(__SSE2__)
+#include <emmintrin.h>
+#define LOX_SCAN_SIMD 1
+#endif
 // testing comment
 namespace Lox 
 {
-  Scanner::Scanner(std::string source) : source(std::move(source))
+  namespace
   {
-    keywords = 
+    // Keywords are recognised with a switch on their first letters, the way
+    // clox does it: no table to build and no hashing, just a compare of the
+    // rest of the word against the one keyword it can still be.
+    constexpr TokenType checkKeyword(std::string_view text, std::size_t start, std::string_view rest, TokenType type)
+    {
+      if (text.size() == start + rest.size() && text.substr(start) == rest)
+        return type;
+      return TokenType::IDENTIFIER;
+    }
+
+    constexpr TokenType keywordType(std::string_view text)
+    {
+      switch (text[0]) {
+        case 'a': return checkKeyword(text, 1, "nd", TokenType::AND);
+        case 'c': return checkKeyword(text, 1, "lass", TokenType::CLASS);
+        case 'e': return checkKeyword(text, 1, "lse", TokenType::ELSE);
+        case 'f':
+          if (text.size() > 1) {
+            switch (text[1]) {
+              case 'a': return checkKeyword(text, 2, "lse", TokenType::FALSE);
+              case 'o': return checkKeyword(text, 2, "r", TokenType::FOR);
+              case 'u': return checkKeyword(text, 2, "n", TokenType::FUN);
+            }
+          }
+          break;
+        case 'i': return checkKeyword(text, 1, "f", TokenType::IF);
+        case 'n': return checkKeyword(text, 1, "il", TokenType::NIL);
+        case 'o': return checkKeyword(text, 1, "r", TokenType::OR);
+        case 'p': return checkKeyword(text, 1, "rint", TokenType::PRINT);
+        case 'r': return checkKeyword(text, 1, "eturn", TokenType::RETURN);
+        case 's': return checkKeyword(text, 1, "uper", TokenType::SUPER);
+        case 't':
+          if (text.size() > 1) {
+            switch (text[1]) {
+              case 'h': return checkKeyword(text, 2, "is", TokenType::THIS);
+              case 'r': return checkKeyword(text, 2, "ue", TokenType::TRUE);
+            }
+          }
+          break;
+        case 'v': return checkKeyword(text, 1, "ar", TokenType::VAR);
+        case 'w': return checkKeyword(text, 1, "hile", TokenType::WHILE);
+      }
+      return TokenType::IDENTIFIER;
+    }
+
+    static_assert(keywordType("while") == TokenType::WHILE);
+    static_assert(keywordType("fun") == TokenType::FUN);
+    static_assert(keywordType("fu") == TokenType::IDENTIFIER);
+    static_assert(keywordType("classy") == TokenType::IDENTIFIER);
+
+    // Character classes, ASCII only so they don't depend on the locale.
+    constexpr bool isDigit(char c)
+    {
+      return c >= '0' && c <= '9';
+    }
+
+    constexpr bool isAlpha(char c)
+    {
+      return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    }
+
+    constexpr bool isIdentifierChar(char c)
+    {
+      return isAlpha(c) || isDigit(c) || c == '_';
+    }
+
+    constexpr bool isWhitespace(char c)
+    {
+      return c == ' ' || c == '\r' || c == '\t' || c == '\n';
+    }
+
+#ifdef LOX_SCAN_SIMD
+    // The fast paths below look at a whole block of source at a time: each
+    // comparison yields a bit mask with one bit per byte of the block, so a
+    // run of similar characters is skipped with a count of trailing zeros
+    // and the newlines in it are counted with a popcount. The last partial
+    // block goes through the scalar loops.
+    using Mask = std::uint32_t;
+
+#ifdef __AVX2__
+    struct Block
     {
-			{"and", TokenType::AND},
-      {"class", TokenType::CLASS},
-      {"else", TokenType::ELSE},
-      {"false", TokenType::FALSE},
-      {"for", TokenType::FOR},
-      {"fun", TokenType::FUN},
-      {"if", TokenType::IF},
-      {"nil", TokenType::NIL},
-      {"or", TokenType::OR},
-      {"print", TokenType::PRINT},
-      {"return", TokenType::RETURN},
-      {"super", TokenType::SUPER},
-      {"this", TokenType::THIS},
-      {"true", TokenType::TRUE},
-      {"var", TokenType::VAR},
-      {"while", TokenType::WHILE},
+      static constexpr int SIZE = 32;
+      static constexpr Mask ALL = 0xFFFFFFFFu;
+
+      explicit Block(const char* p) : bytes(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))) {}
+
+      Mask eq(char c) const
+      {
+        return static_cast<Mask>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(c))));
+      }
+      // Bytes in [lo, hi]; both bounds must be ASCII, so bytes >= 0x80,
+      // which compare as negative, never match.
+      Mask between(char lo, char hi) const
+      {
+        __m256i above = _mm256_cmpgt_epi8(bytes, _mm256_set1_epi8(lo - 1));
+        __m256i below = _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), bytes);
+        return static_cast<Mask>(_mm256_movemask_epi8(_mm256_and_si256(above, below)));
+      }
+      // Folds ASCII letters to lower case; other bytes may change too, so
+      // only use the result to look for letters.
+      Block lower() const { return Block(_mm256_or_si256(bytes, _mm256_set1_epi8(0x20))); }
+
+      __m256i bytes;
+
+    private:
+      explicit Block(__m256i bytes) : bytes(bytes) {}
     };
+#else
+    struct Block
+    {
+      static constexpr int SIZE = 16;
+      static constexpr Mask ALL = 0xFFFFu;
+
+      explicit Block(const char* p) : bytes(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) {}
+
+      Mask eq(char c) const
+      {
+        return static_cast<Mask>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(c))));
+      }
+      // Bytes in [lo, hi]; both bounds must be ASCII, so bytes >= 0x80,
+      // which compare as negative, never match.
+      Mask between(char lo, char hi) const
+      {
+        __m128i above = _mm_cmpgt_epi8(bytes, _mm_set1_epi8(lo - 1));
+        __m128i below = _mm_cmpgt_epi8(_mm_set1_epi8(hi + 1), bytes);
+        return static_cast<Mask>(_mm_movemask_epi8(_mm_and_si128(above, below)));
+      }
+      // Folds ASCII letters to lower case; other bytes may change too, so
+      // only use the result to look for letters.
+      Block lower() const { return Block(_mm_or_si128(bytes, _mm_set1_epi8(0x20))); }
+
+      __m128i bytes;
+
+    private:
+      explicit Block(__m128i bytes) : bytes(bytes) {}
+    };
+#endif
+
+    // Newlines among the first n bytes of the block.
+    int newlinesBefore(Mask newlines, int n)
+    {
+      return __builtin_popcount(newlines & ((Mask{1} << n) - 1));
+    }
+#endif
+
+    // Each of these returns where the run starting at p ends, at the latest
+    // at end.
+
+    // Whitespace, counting the newlines skipped.
+    const char* skipWhitespace(const char* p, const char* end, int& line)
+    {
+#ifdef LOX_SCAN_SIMD
+      while (end - p >= Block::SIZE)
+      {
+        Block block(p);
+        Mask newlines = block.eq('\n');
+        Mask spaces = block.eq(' ') | block.eq('\t') | block.eq('\r') | newlines;
+        if (spaces != Block::ALL)
+        {
+          int n = __builtin_ctz(~spaces);
+          line += newlinesBefore(newlines, n);
+          return p + n;
+        }
+        line += __builtin_popcount(newlines);
+        p += Block::SIZE;
+      }
+#endif
+      for (; p < end && isWhitespace(*p); p++)
+        if (*p == '\n')
+          line++;
+      return p;
+    }
+
+    // Identifier characters.
+    const char* skipIdentifier(const char* p, const char* end)
+    {
+#ifdef LOX_SCAN_SIMD
+      while (end - p >= Block::SIZE)
+      {
+        Block block(p);
+        Mask chars = block.lower().between('a', 'z') | block.between('0', '9') | block.eq('_');
+        if (chars != Block::ALL)
+          return p + __builtin_ctz(~chars);
+        p += Block::SIZE;
+      }
+#endif
+      while (p < end && isIdentifierChar(*p))
+        p++;
+      return p;
+    }
+
+    // A string body, up to the closing quote, counting its newlines.
+    const char* skipString(const char* p, const char* end, int& line)
+    {
+#ifdef LOX_SCAN_SIMD
+      while (end - p >= Block::SIZE)
+      {
+        Block block(p);
+        Mask newlines = block.eq('\n');
+        Mask quotes = block.eq('"');
+        if (quotes != 0)
+        {
+          int n = __builtin_ctz(quotes);
+          line += newlinesBefore(newlines, n);
+          return p + n;
+        }
+        line += __builtin_popcount(newlines);
+        p += Block::SIZE;
+      }
+#endif
+      for (; p < end && *p != '"'; p++)
+        if (*p == '\n')
+          line++;
+      return p;
+    }
+
+    // A comment body, up to the newline. memchr is already vectorised by
+    // the C library.
+    const char* skipComment(const char* p, const char* end)
+    {
+      const void* newline = std::memchr(p, '\n', end - p);
+      return newline != nullptr ? static_cast<const char*>(newline) : end;
+    }
   }
+
+  Scanner::Scanner(std::string_view source) : source(source)
+  {}
   std::vector<Token> Scanner::scanTokens() 
   {
     while(!isAtEnd()) {
@@ -35,7 +255,8 @@ namespace Lox
       scanToken();
     }
     tokens.emplace_back(TokenType::TokenEOF, "", line);
-    return tokens;
+    RunStats::current.tokens += tokens.size();
+    return std::move(tokens);
   }
   void Scanner::scanToken() 
   {
@@ -66,25 +287,25 @@ namespace Lox
       case '/':
         if (match('/')) {
           // A comment goes until the end of the line.
-          while (peek() != '\n' && !isAtEnd())
-            advance();
+          current = static_cast<int>(skipComment(source.data() + current, source.data() + source.size()) - source.data());
         } else {
           addToken(TokenType::SLASH);
         }
         break;
+      case '\n':
+        line++;
+        [[fallthrough]];
       case ' ':
       case '\r':
       case '\t':
-        // Ignore whitespace
-        break;
-      case '\n':
-        line++;
+        // Ignore whitespace, along with any that follows.
+        current = static_cast<int>(skipWhitespace(source.data() + current, source.data() + source.size(), line) - source.data());
         break;
       case '"': string(); break;
       default:  
-        if(std::isdigit(c)){
+        if(isDigit(c)){
           number();
-        } else if (std::isalpha(c)){
+        } else if (isAlpha(c)){
           identifier();
         } else {
           Lox::Error(line, "Unexpected character."); break;
@@ -93,11 +314,7 @@ namespace Lox
   }
   void Scanner::string()
   {
-    while(peek() != '"' && !isAtEnd())
-    {
-      if(peek() == '\n') line++;
-      advance();
-    }
+    current = static_cast<int>(skipString(source.data() + current, source.data() + source.size(), line) - source.data());
 
     if (isAtEnd()) 
     {
@@ -109,43 +326,36 @@ namespace Lox
     advance();
     
     // Trim the surrounding quotes.
-    std::string value = source.substr(start + 1, current - start - 2);
-    addToken(TokenType::STRING, value);
+    addToken(TokenType::STRING, source.substr(start + 1, current - start - 2));
   }
 
   void Scanner::number()
   {
-    while(std::isdigit(peek())) advance();
+    while(isDigit(peek())) advance();
     // Look for a fractional part.
-    if (peek() == '.' && std::isdigit(peekNext())){
+    if (peek() == '.' && isDigit(peekNext())){
       // Consume the "."
       advance();
 
-      while(std::isdigit(peek())) advance();
+      while(isDigit(peek())) advance();
     }
-    addToken(TokenType::NUMBER, std::stod(source.substr(start, current - start)));
+    double value = 0;
+    std::from_chars(source.data() + start, source.data() + current, value);
+    addToken(TokenType::NUMBER, value);
   }
 
   void Scanner::identifier()
   {
-    //char c = peek();
-    while(std::isalpha(peek()) || std::isdigit(peek()) || peek() == '_'){ 
-			advance();
-		}
-
-		const auto text = source.substr(start, current - start);
-		if(const auto it = keywords.find(text); it != keywords.end()) {
-			addToken(it->second);
-		}	else {
-			addToken(TokenType::IDENTIFIER);
-		}	
+    current = static_cast<int>(skipIdentifier(source.data() + current, source.data() + source.size()) - source.data());
+
+		addToken(keywordType(source.substr(start, current - start)));
   }
 
   bool Scanner::match(char expected) 
   {
     if (isAtEnd()) 
       return false;
-    if (source.at(current) != expected)
+    if (source[current] != expected)
       return false;
 
     current++;
@@ -155,12 +365,12 @@ namespace Lox
   {
     if (isAtEnd())
       return '\0';
-    return source.at(current);
+    return source[current];
   }
   char Scanner::peekNext() const
   {
     if(current + 1 >= static_cast<int>(source.size())) return '\0';
-    return source.at(current+1);
+    return source[current+1];
   }
   bool Scanner::isAtEnd() const
   {
@@ -169,16 +379,15 @@ namespace Lox
   char Scanner::advance()
   {
     current++;
-    return source.at(current-1);
+    return source[current-1];
   }
   void Scanner::addToken(TokenType type)
   {
-    addToken(type, NULL);
+    addToken(type, std::monostate{});
   }
-  void Scanner::addToken(TokenType type, std::any literal)
+  void Scanner::addToken(TokenType type, TokenLiteral literal)
   {
-    std::string text = source.substr(start, current-start);
-    tokens.emplace_back(type, text, literal, line);
+    tokens.emplace_back(type, source.substr(start, current-start), literal, line);
   }
 
 }
@@ -0,0 +1,27 @@
+#include "Shape.h"
+
+namespace Lox
+{
+    static std::uint32_t nextShapeId = 1;
+
+    Shape::Shape() : id(nextShapeId++)
+    {}
+
+    int Shape::lookup(std::string_view name) const
+    {
+        auto it = slots.find(name);
+        return it != slots.end() ? it->second : -1;
+    }
+
+    Shape* Shape::withField(std::string_view name)
+    {
+        std::unique_ptr<Shape>& next = transitions[name];
+        if (!next)
+        {
+            next = std::make_unique<Shape>();
+            next->slots = slots;
+            next->slots.emplace(name, fieldCount());
+        }
+        return next.get();
+    }
+}
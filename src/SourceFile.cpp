@@ -0,0 +1,91 @@
+#include "SourceFile.h"
+
+#include <fstream>
+#include <iterator>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define LOX_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Lox
+{
+    SourceFile::SourceFile(std::string text) : buffer(std::move(text)), view(buffer)
+    {}
+
+    SourceFile::~SourceFile()
+    {
+#ifdef LOX_HAVE_MMAP
+        if (mapping != nullptr)
+            munmap(mapping, mappingSize);
+#endif
+    }
+
+    bool SourceFile::open(const std::string& path)
+    {
+        return map(path) || read(path);
+    }
+
+    bool SourceFile::map(const std::string& path)
+    {
+#ifdef LOX_HAVE_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat info;
+        // Empty files can't be mapped, and pipes or devices have no size to
+        // map; both are left to read().
+        if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0)
+        {
+            close(fd);
+            return false;
+        }
+
+        std::size_t size = static_cast<std::size_t>(info.st_size);
+        void* memory = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        // The mapping stays valid after the descriptor is closed.
+        close(fd);
+        if (memory == MAP_FAILED)
+            return false;
+
+        madvise(memory, size, MADV_SEQUENTIAL);
+        mapping = memory;
+        mappingSize = size;
+        view = std::string_view(static_cast<const char*>(memory), size);
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    bool SourceFile::read(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.good())
+            return false;
+
+        file.seekg(0, std::ios::end);
+        std::streamoff size = file.tellg();
+        if (size > 0)
+        {
+            // Sized up front so the file is copied exactly once.
+            buffer.resize(static_cast<std::size_t>(size));
+            file.seekg(0, std::ios::beg);
+            file.read(buffer.data(), size);
+            buffer.resize(static_cast<std::size_t>(file.gcount()));
+        }
+        else
+        {
+            // Not seekable: read it in chunks.
+            file.clear();
+            buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+        view = buffer;
+        return !file.bad();
+    }
+}
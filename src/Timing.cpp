@@ -0,0 +1,51 @@
+#include "Timing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+
+namespace Lox
+{
+    namespace
+    {
+        using Clock = std::chrono::steady_clock;
+
+        const Clock::time_point programStart = Clock::now();
+    }
+
+    double clockSeconds()
+    {
+        return std::chrono::duration<double>(Clock::now() - programStart).count();
+    }
+
+    double clockNanos()
+    {
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - programStart).count());
+    }
+
+    double percentile(const std::vector<double>& sorted, double p)
+    {
+        std::size_t rank = static_cast<std::size_t>(std::ceil(p / 100 * sorted.size()));
+        return sorted[std::max<std::size_t>(rank, 1) - 1];
+    }
+
+    bool isValidBenchIterations(double iterations)
+    {
+        return iterations >= 1 && iterations <= MAX_BENCH_ITERATIONS && std::floor(iterations) == iterations;
+    }
+
+    TimingStats TimingStats::summarize(std::vector<double>& samples)
+    {
+        std::sort(samples.begin(), samples.end());
+        TimingStats stats;
+        stats.iterations = static_cast<double>(samples.size());
+        stats.total = std::accumulate(samples.begin(), samples.end(), 0.0);
+        stats.mean = stats.total / samples.size();
+        stats.min = samples.front();
+        stats.median = percentile(samples, 50);
+        stats.p95 = percentile(samples, 95);
+        stats.max = samples.back();
+        return stats;
+    }
+}
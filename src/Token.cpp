@@ -2,19 +2,19 @@
 
 namespace Lox
 {
-  Token::Token(TokenType type, std::string lexeme, int line) :
-    Token(type, lexeme, std::any{}, line)
+  Token::Token(TokenType type, std::string_view lexeme, int line) :
+    Token(type, lexeme, std::monostate{}, line)
   {}
-  Token::Token(TokenType type, std::string lexeme, std::any literal, int line) :
-    type(type),
-    lexeme(std::move(lexeme)),
+  Token::Token(TokenType type, std::string_view lexeme, TokenLiteral literal, int line) :
+    lexeme(lexeme),
     literal(literal),
+    type(type),
     line(line)
   {}
 
   std::string Token::toString() const
   {
-    return std::to_string(static_cast<int>(type)) + ", lexeme: '" + lexeme + "' , literal: '" +
+    return std::to_string(static_cast<int>(type)) + ", lexeme: '" + std::string(lexeme) + "' , literal: '" +
       literalToString() + "'";
   }
 
@@ -22,9 +22,9 @@ namespace Lox
   {
     switch(type) {
       case TokenType::STRING:
-        return std::any_cast<std::string>(literal);
+        return std::string(std::get<std::string_view>(literal));
       case TokenType::NUMBER:
-        return std::to_string(std::any_cast<double>(literal));
+        return std::to_string(std::get<double>(literal));
       default:
         return "";
     }
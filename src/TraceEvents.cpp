@@ -0,0 +1,46 @@
+#include "TraceEvents.h"
+
+#include <fmt/core.h>
+
+#include "Timing.h"
+
+namespace Lox
+{
+    std::FILE* TraceEvents::file = nullptr;
+    bool TraceEvents::first = true;
+    double TraceEvents::callThreshold = 100;
+
+    bool TraceEvents::open(const std::string& path)
+    {
+        file = std::fopen(path.c_str(), "w");
+        if (file == nullptr)
+            return false;
+        fmt::print(file, "{{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+        return true;
+    }
+
+    void TraceEvents::close()
+    {
+        if (file == nullptr)
+            return;
+        fmt::print(file, "\n]}}\n");
+        std::fclose(file);
+        file = nullptr;
+    }
+
+    double TraceEvents::now()
+    {
+        return clockNanos() / 1000;
+    }
+
+    // Names are phase names and Lox identifiers, so they never need escaping.
+    void TraceEvents::complete(std::string_view name, const char* category, double start, double end, int line)
+    {
+        fmt::print(file, "{}\n{{\"name\": \"{}\", \"cat\": \"{}\", \"ph\": \"X\", \"ts\": {:.3f}, \"dur\": {:.3f}, \"pid\": 1, \"tid\": 1",
+            first ? "" : ",", name, category, start, end - start);
+        if (line != 0)
+            fmt::print(file, ", \"args\": {{\"line\": {}}}", line);
+        fmt::print(file, "}}");
+        first = false;
+    }
+}
@@ -0,0 +1,752 @@
+#include "VM.h"
+
+#include "Compiler.h"
+#include "GC.h"
+#include "Lox.h"
+#include "RunStats.h"
+#include "Timing.h"
+
+#include <iostream>
+
+#include <fmt/core.h>
+
+// Threaded dispatch through a table of label addresses is a GNU extension;
+// other compilers get a plain switch inside the loop.
+#if defined(__GNUC__) || defined(__clang__)
+#define LOX_COMPUTED_GOTO 1
+#endif
+
+namespace Lox
+{
+    namespace
+    {
+        template<typename T>
+        T* as(const Value& value)
+        {
+            return static_cast<T*>(value.asObject());
+        }
+
+        bool clockNative(VM&, int, Value*, Value& result)
+        {
+            result = clockSeconds();
+            return true;
+        }
+
+        bool clockNanosNative(VM&, int, Value*, Value& result)
+        {
+            result = clockNanos();
+            return true;
+        }
+
+        // Number of arguments a call to the value takes, or -1 if it can't be
+        // called.
+        int arityOf(const Value& value)
+        {
+            if (!value.isObject())
+                return -1;
+            switch (value.asObject()->getObjectType())
+            {
+                case ObjectType::VM_CLOSURE: return as<ObjClosure>(value)->function->arity;
+                case ObjectType::VM_BOUND_METHOD: return as<ObjBoundMethod>(value)->method->function->arity;
+                case ObjectType::VM_NATIVE: return as<ObjNative>(value)->arity;
+                case ObjectType::VM_CLASS:
+                {
+                    ObjClosure* initializer = as<ObjClass>(value)->initializer;
+                    return initializer != nullptr ? initializer->function->arity : 0;
+                }
+                default: return -1;
+            }
+        }
+
+        // bench(fn, iterations) calls fn that many times, timing each call,
+        // and returns a BenchStats instance with the per-call times in
+        // seconds.
+        bool benchNative(VM& vm, int, Value* args, Value& result)
+        {
+            if (arityOf(args[0]) != 0)
+            {
+                vm.runtimeError("bench() expects a function taking no arguments.");
+                return false;
+            }
+            if (!args[1].isNumber() || !isValidBenchIterations(args[1].asNumber()))
+            {
+                vm.runtimeError("bench() expects a whole number of iterations from 1 to 10000000.");
+                return false;
+            }
+
+            const std::size_t iterations = static_cast<std::size_t>(args[1].asNumber());
+            std::vector<double> samples;
+            samples.reserve(iterations);
+            for (std::size_t i = 0; i < iterations; i++)
+            {
+                double start = clockSeconds();
+                Value ignored;
+                if (!vm.callFromNative(args[0], ignored))
+                    return false;
+                samples.push_back(clockSeconds() - start);
+            }
+
+            result = vm.makeBenchStats(TimingStats::summarize(samples));
+            return true;
+        }
+    }
+
+    VM::VM(std::ostream& out)
+        : stack(std::make_unique<Value[]>(STACK_MAX)), stackTop(stack.get()), out(out)
+    {
+        resetStack();
+        initString = intern("init").get();
+        benchStatsClass = makeRef<ObjClass>(intern("BenchStats"));
+        defineNative("clock", &clockNative, 0);
+        defineNative("clockNanos", &clockNanosNative, 0);
+        defineNative("bench", &benchNative, 2);
+    }
+
+    VM::~VM() = default;
+
+    Value VM::makeBenchStats(const TimingStats& stats)
+    {
+        Ref<ObjInstance> instance = makeRef<ObjInstance>(benchStatsClass);
+        stats.forEachField([&](const char* name, double value) {
+            instance->fields[intern(name).get()] = value;
+        });
+        return instance;
+    }
+
+    void VM::interpret(const std::vector<Stmt*>& statements)
+    {
+        Compiler compiler(*this);
+        Ref<ObjFunction> function = compiler.compile(statements);
+        if (function == nullptr)
+            return;
+
+        Ref<ObjClosure> closure = makeRef<ObjClosure>(function);
+        push(closure);
+        call(closure.get(), 0);
+        if (!run())
+            resetStack();
+        out.flush();
+    }
+
+    Ref<LoxString> VM::intern(std::string_view chars)
+    {
+        std::string key(chars);
+        auto it = strings.find(key);
+        if (it != strings.end())
+            return it->second;
+
+        Ref<LoxString> string = makeRef<LoxString>(key);
+        strings.emplace(std::move(key), string);
+        return string;
+    }
+
+    int VM::globalSlot(std::string_view name)
+    {
+        std::string key(name);
+        auto it = globalSlots.find(key);
+        if (it != globalSlots.end())
+            return it->second;
+
+        int slot = static_cast<int>(globals.size());
+        globals.push_back(Global{Value{}, false});
+        globalNames.push_back(key);
+        globalSlots.emplace(std::move(key), slot);
+        return slot;
+    }
+
+    bool VM::callFromNative(const Value& callee, Value& result)
+    {
+        push(callee);
+        int baseFrame = frameCount;
+        if (!callValue(callee, 0))
+            return false;
+        // Natives and initializer-less classes finish inside callValue().
+        if (frameCount > baseFrame && !run(baseFrame))
+            return false;
+        result = pop();
+        return true;
+    }
+
+    bool VM::run(int baseFrame)
+    {
+        CallFrame* frame = &frames[frameCount - 1];
+        const std::uint8_t* ip = frame->ip;
+
+#define READ_BYTE() (*ip++)
+#define READ_SHORT() (ip += 2, static_cast<std::uint16_t>((ip[-2] << 8) | ip[-1]))
+#define READ_CONSTANT() (frame->closure->function->chunk.constants[READ_SHORT()])
+#define READ_STRING() as<LoxString>(READ_CONSTANT())
+// Anything that can call, fail or look at the current line needs the frame's
+// ip to be up to date; callers reload it afterwards since frame may change.
+#define SAVE_IP() (frame->ip = ip)
+#define LOAD_FRAME() (frame = &frames[frameCount - 1], ip = frame->ip)
+#define RUNTIME_ERROR(...)                       \
+        do {                                     \
+            SAVE_IP();                           \
+            runtimeError(fmt::format(__VA_ARGS__)); \
+            return false;                        \
+        } while (false)
+#define BINARY_NUMBER_OP(op)                                  \
+        do {                                                  \
+            if (!peek(0).isNumber() || !peek(1).isNumber())   \
+                RUNTIME_ERROR("Operands must be numbers.");   \
+            double b = pop().asNumber();                      \
+            double a = pop().asNumber();                      \
+            push(Value(a op b));                              \
+        } while (false)
+
+#ifdef LOX_COMPUTED_GOTO
+        static void* dispatchTable[] = {
+            #define LOX_OPCODE_LABEL(name) &&op_##name,
+            LOX_OPCODES(LOX_OPCODE_LABEL)
+            #undef LOX_OPCODE_LABEL
+        };
+// A computed goto leaves the current block without running destructors, so
+// any Value or Ref local must be moved from or out of scope by DISPATCH().
+#define DISPATCH() goto *dispatchTable[READ_BYTE()]
+#define CASE(name) op_##name:
+        DISPATCH();
+#else
+#define DISPATCH() continue
+#define CASE(name) case OpCode::name:
+        for (;;)
+        {
+        switch (static_cast<OpCode>(READ_BYTE()))
+        {
+#endif
+            CASE(CONSTANT)
+            {
+                push(READ_CONSTANT());
+                DISPATCH();
+            }
+            CASE(NIL) { push(Value{}); DISPATCH(); }
+            CASE(TRUE) { push(Value(true)); DISPATCH(); }
+            CASE(FALSE) { push(Value(false)); DISPATCH(); }
+            CASE(POP) { pop(); DISPATCH(); }
+            CASE(GET_LOCAL)
+            {
+                std::uint8_t slot = READ_BYTE();
+                push(frame->slots[slot]);
+                DISPATCH();
+            }
+            CASE(SET_LOCAL)
+            {
+                std::uint8_t slot = READ_BYTE();
+                frame->slots[slot] = peek(0);
+                DISPATCH();
+            }
+            CASE(GET_GLOBAL)
+            {
+                std::uint16_t slot = READ_SHORT();
+                const Global& global = globals[slot];
+                if (!global.defined)
+                    RUNTIME_ERROR("Undefined variable '{}'.", globalNames[slot]);
+                push(global.value);
+                DISPATCH();
+            }
+            CASE(DEFINE_GLOBAL)
+            {
+                std::uint16_t slot = READ_SHORT();
+                globals[slot] = Global{pop(), true};
+                DISPATCH();
+            }
+            CASE(SET_GLOBAL)
+            {
+                std::uint16_t slot = READ_SHORT();
+                Global& global = globals[slot];
+                if (!global.defined)
+                    RUNTIME_ERROR("Undefined variable '{}'.", globalNames[slot]);
+                global.value = peek(0);
+                DISPATCH();
+            }
+            CASE(GET_UPVALUE)
+            {
+                std::uint8_t slot = READ_BYTE();
+                push(*frame->closure->upvalues[slot]->location);
+                DISPATCH();
+            }
+            CASE(SET_UPVALUE)
+            {
+                std::uint8_t slot = READ_BYTE();
+                *frame->closure->upvalues[slot]->location = peek(0);
+                DISPATCH();
+            }
+            CASE(GET_PROPERTY)
+            {
+                if (!peek(0).isObjectType(ObjectType::VM_INSTANCE))
+                    RUNTIME_ERROR("Only instances have properties.");
+
+                ObjInstance* instance = as<ObjInstance>(peek(0));
+                LoxString* name = READ_STRING();
+
+                auto field = instance->fields.find(name);
+                if (field != instance->fields.end())
+                {
+                    Value value = field->second;
+                    pop();
+                    push(std::move(value));
+                    DISPATCH();
+                }
+
+                SAVE_IP();
+                if (!bindMethod(instance->klass.get(), name))
+                    return false;
+                DISPATCH();
+            }
+            CASE(SET_PROPERTY)
+            {
+                if (!peek(1).isObjectType(ObjectType::VM_INSTANCE))
+                    RUNTIME_ERROR("Only instances have fields.");
+
+                ObjInstance* instance = as<ObjInstance>(peek(1));
+                instance->fields[READ_STRING()] = peek(0);
+                Value value = pop();
+                pop();
+                push(std::move(value));
+                DISPATCH();
+            }
+            CASE(GET_SUPER)
+            {
+                LoxString* name = READ_STRING();
+                {
+                    Value superclass = pop();
+                    SAVE_IP();
+                    if (!bindMethod(as<ObjClass>(superclass), name))
+                        return false;
+                }
+                DISPATCH();
+            }
+            CASE(EQUAL)
+            {
+                bool equal = peek(1) == peek(0);
+                pop();
+                pop();
+                push(Value(equal));
+                DISPATCH();
+            }
+            CASE(NOT_EQUAL)
+            {
+                bool equal = peek(1) == peek(0);
+                pop();
+                pop();
+                push(Value(!equal));
+                DISPATCH();
+            }
+            CASE(GREATER) { BINARY_NUMBER_OP(>); DISPATCH(); }
+            CASE(GREATER_EQUAL) { BINARY_NUMBER_OP(>=); DISPATCH(); }
+            CASE(LESS) { BINARY_NUMBER_OP(<); DISPATCH(); }
+            CASE(LESS_EQUAL) { BINARY_NUMBER_OP(<=); DISPATCH(); }
+            CASE(ADD)
+            {
+                if (peek(0).isNumber() && peek(1).isNumber())
+                {
+                    double b = pop().asNumber();
+                    double a = pop().asNumber();
+                    push(Value(a + b));
+                }
+                else if (peek(0).isString() && peek(1).isString())
+                {
+                    Value b = pop();
+                    Value a = pop();
+                    push(concatenate(*a.asString(), *b.asString()));
+                }
+                else
+                {
+                    RUNTIME_ERROR("Operands must be two numbers or two strings.");
+                }
+                DISPATCH();
+            }
+            CASE(SUBTRACT) { BINARY_NUMBER_OP(-); DISPATCH(); }
+            CASE(MULTIPLY) { BINARY_NUMBER_OP(*); DISPATCH(); }
+            CASE(DIVIDE) { BINARY_NUMBER_OP(/); DISPATCH(); }
+            CASE(NOT)
+            {
+                push(Value(!pop().isTruthy()));
+                DISPATCH();
+            }
+            CASE(NEGATE)
+            {
+                if (!peek(0).isNumber())
+                    RUNTIME_ERROR("Operand must be a number.");
+                push(Value(-pop().asNumber()));
+                DISPATCH();
+            }
+            CASE(PRINT)
+            {
+                print(pop());
+                if (buffering == OutputBuffering::LINE)
+                    out.flush();
+                DISPATCH();
+            }
+            CASE(JUMP)
+            {
+                std::uint16_t offset = READ_SHORT();
+                ip += offset;
+                DISPATCH();
+            }
+            CASE(JUMP_IF_FALSE)
+            {
+                std::uint16_t offset = READ_SHORT();
+                if (!peek(0).isTruthy())
+                    ip += offset;
+                DISPATCH();
+            }
+            CASE(LOOP)
+            {
+                std::uint16_t offset = READ_SHORT();
+                ip -= offset;
+                GC::collectIfNeeded();
+                DISPATCH();
+            }
+            CASE(CALL)
+            {
+                int argCount = READ_BYTE();
+                SAVE_IP();
+                if (!callValue(peek(argCount), argCount))
+                    return false;
+                LOAD_FRAME();
+                DISPATCH();
+            }
+            CASE(INVOKE)
+            {
+                LoxString* method = READ_STRING();
+                int argCount = READ_BYTE();
+                SAVE_IP();
+                if (!invoke(method, argCount))
+                    return false;
+                LOAD_FRAME();
+                DISPATCH();
+            }
+            CASE(SUPER_INVOKE)
+            {
+                LoxString* method = READ_STRING();
+                int argCount = READ_BYTE();
+                {
+                    Value superclass = pop();
+                    SAVE_IP();
+                    if (!invokeFromClass(as<ObjClass>(superclass), method, argCount))
+                        return false;
+                }
+                LOAD_FRAME();
+                DISPATCH();
+            }
+            CASE(CLOSURE)
+            {
+                push(makeRef<ObjClosure>(as<ObjFunction>(READ_CONSTANT())));
+                ObjClosure* closure = as<ObjClosure>(peek(0));
+                for (auto& upvalue : closure->upvalues)
+                {
+                    std::uint8_t isLocal = READ_BYTE();
+                    std::uint8_t index = READ_BYTE();
+                    if (isLocal)
+                        upvalue = captureUpvalue(frame->slots + index);
+                    else
+                        upvalue = frame->closure->upvalues[index];
+                }
+                DISPATCH();
+            }
+            CASE(CLOSE_UPVALUE)
+            {
+                closeUpvalues(stackTop - 1);
+                pop();
+                DISPATCH();
+            }
+            CASE(RETURN)
+            {
+                Value result = pop();
+                closeUpvalues(frame->slots);
+                frameCount--;
+                if (frameCount == 0)
+                {
+                    pop();
+                    return true;
+                }
+
+                while (stackTop > frame->slots)
+                    pop();
+                push(std::move(result));
+                if (frameCount == baseFrame)
+                    return true;
+                LOAD_FRAME();
+                DISPATCH();
+            }
+            CASE(CLASS)
+            {
+                push(makeRef<ObjClass>(READ_STRING()));
+                DISPATCH();
+            }
+            CASE(INHERIT)
+            {
+                if (!peek(1).isObjectType(ObjectType::VM_CLASS))
+                    RUNTIME_ERROR("Superclass must be a class.");
+
+                ObjClass* superclass = as<ObjClass>(peek(1));
+                ObjClass* subclass = as<ObjClass>(peek(0));
+                // Copy-down inheritance: methods declared in the subclass are
+                // added afterwards and override these.
+                subclass->methods = superclass->methods;
+                subclass->initializer = superclass->initializer;
+                pop();
+                DISPATCH();
+            }
+            CASE(METHOD)
+            {
+                defineMethod(READ_STRING());
+                DISPATCH();
+            }
+#ifndef LOX_COMPUTED_GOTO
+        }
+        }
+#endif
+
+#undef READ_BYTE
+#undef READ_SHORT
+#undef READ_CONSTANT
+#undef READ_STRING
+#undef SAVE_IP
+#undef LOAD_FRAME
+#undef RUNTIME_ERROR
+#undef BINARY_NUMBER_OP
+#undef DISPATCH
+#undef CASE
+    }
+
+    bool VM::call(ObjClosure* closure, int argCount)
+    {
+        if (argCount != closure->function->arity)
+        {
+            runtimeError(fmt::format("Expected {} arguments, but got {}.",
+                closure->function->arity, argCount));
+            return false;
+        }
+
+        if (frameCount == FRAMES_MAX)
+        {
+            runtimeError("Stack overflow.");
+            return false;
+        }
+
+        CallFrame* frame = &frames[frameCount++];
+        frame->closure = closure;
+        frame->ip = closure->function->chunk.code.data();
+        frame->slots = stackTop - argCount - 1;
+        GC::collectIfNeeded();
+        return true;
+    }
+
+    bool VM::callValue(const Value& callee, int argCount)
+    {
+        if (callee.isObject())
+        {
+            switch (callee.asObject()->getObjectType())
+            {
+                case ObjectType::VM_BOUND_METHOD:
+                {
+                    ObjBoundMethod* bound = as<ObjBoundMethod>(callee);
+                    Ref<ObjClosure> method = bound->method;
+                    stackTop[-argCount - 1] = bound->receiver;
+                    RunStats::current.calls++;
+                    return call(method.get(), argCount);
+                }
+                case ObjectType::VM_CLASS:
+                {
+                    Ref<ObjClass> klass = as<ObjClass>(callee);
+                    stackTop[-argCount - 1] = makeRef<ObjInstance>(klass);
+                    RunStats::current.instances++;
+                    if (klass->initializer != nullptr)
+                    {
+                        RunStats::current.calls++;
+                        return call(klass->initializer, argCount);
+                    }
+                    if (argCount != 0)
+                    {
+                        runtimeError(fmt::format("Expected 0 arguments, but got {}.", argCount));
+                        return false;
+                    }
+                    return true;
+                }
+                case ObjectType::VM_CLOSURE:
+                    RunStats::current.calls++;
+                    return call(as<ObjClosure>(callee), argCount);
+                case ObjectType::VM_NATIVE:
+                {
+                    ObjNative* native = as<ObjNative>(callee);
+                    if (argCount != native->arity)
+                    {
+                        runtimeError(fmt::format("Expected {} arguments, but got {}.",
+                            native->arity, argCount));
+                        return false;
+                    }
+                    RunStats::current.calls++;
+                    Value result;
+                    if (!native->function(*this, argCount, stackTop - argCount, result))
+                        return false;
+                    for (int i = 0; i <= argCount; i++)
+                        pop();
+                    push(std::move(result));
+                    return true;
+                }
+                default:
+                    break;
+            }
+        }
+
+        runtimeError("Can only call functions and classes.");
+        return false;
+    }
+
+    bool VM::invoke(LoxString* name, int argCount)
+    {
+        const Value& receiver = peek(argCount);
+        if (!receiver.isObjectType(ObjectType::VM_INSTANCE))
+        {
+            runtimeError("Only instances have properties.");
+            return false;
+        }
+
+        ObjInstance* instance = as<ObjInstance>(receiver);
+        auto field = instance->fields.find(name);
+        if (field != instance->fields.end())
+        {
+            Value callee = field->second;
+            stackTop[-argCount - 1] = callee;
+            return callValue(callee, argCount);
+        }
+
+        return invokeFromClass(instance->klass.get(), name, argCount);
+    }
+
+    bool VM::invokeFromClass(ObjClass* klass, LoxString* name, int argCount)
+    {
+        auto method = klass->methods.find(name);
+        if (method == klass->methods.end())
+        {
+            runtimeError(fmt::format("Undefined property '{}'.", name->chars));
+            return false;
+        }
+        RunStats::current.calls++;
+        return call(method->second.get(), argCount);
+    }
+
+    bool VM::bindMethod(ObjClass* klass, LoxString* name)
+    {
+        auto method = klass->methods.find(name);
+        if (method == klass->methods.end())
+        {
+            runtimeError(fmt::format("Undefined property '{}'.", name->chars));
+            return false;
+        }
+
+        Value receiver = pop();
+        push(makeRef<ObjBoundMethod>(std::move(receiver), method->second));
+        RunStats::current.boundMethods++;
+        return true;
+    }
+
+    Ref<ObjUpvalue> VM::captureUpvalue(Value* local)
+    {
+        // Open upvalues are kept sorted by stack slot, highest first.
+        Ref<ObjUpvalue> previous;
+        Ref<ObjUpvalue> upvalue = openUpvalues;
+        while (upvalue != nullptr && upvalue->location > local)
+        {
+            previous = upvalue;
+            upvalue = upvalue->next;
+        }
+
+        if (upvalue != nullptr && upvalue->location == local)
+            return upvalue;
+
+        Ref<ObjUpvalue> created = makeRef<ObjUpvalue>(local);
+        created->next = upvalue;
+        if (previous == nullptr)
+            openUpvalues = created;
+        else
+            previous->next = created;
+        return created;
+    }
+
+    void VM::closeUpvalues(Value* last)
+    {
+        while (openUpvalues != nullptr && openUpvalues->location >= last)
+        {
+            Ref<ObjUpvalue> upvalue = openUpvalues;
+            upvalue->closed = *upvalue->location;
+            upvalue->location = &upvalue->closed;
+            openUpvalues = upvalue->next;
+            upvalue->next = nullptr;
+        }
+    }
+
+    void VM::defineMethod(LoxString* name)
+    {
+        Ref<ObjClosure> method = as<ObjClosure>(peek(0));
+        ObjClass* klass = as<ObjClass>(peek(1));
+        klass->methods[name] = method;
+        if (name == initString)
+            klass->initializer = method.get();
+        pop();
+    }
+
+    void VM::defineNative(const std::string& name, NativeFn function, int arity)
+    {
+        globals[globalSlot(name)] = Global{makeRef<ObjNative>(function, arity), true};
+    }
+
+    void VM::resetStack()
+    {
+        closeUpvalues(stack.get());
+        while (stackTop > stack.get())
+            pop();
+        stackTop = stack.get();
+        frameCount = 0;
+        openUpvalues = nullptr;
+    }
+
+    void VM::runtimeError(const std::string& message)
+    {
+        const CallFrame& frame = frames[frameCount - 1];
+        const Chunk& chunk = frame.closure->function->chunk;
+        std::size_t instruction = frame.ip - chunk.code.data() - 1;
+        out.flush();
+        Lox::ReportRuntimeError(chunk.lines[instruction], message);
+    }
+
+    void VM::print(const Value& value)
+    {
+        if (!writeValue(out, value))
+            out << stringify(value);
+        out.put('\n');
+    }
+
+    std::string VM::stringify(const Value& value) const
+    {
+        switch (value.getType())
+        {
+            case ValueType::NIL: return "nil";
+            case ValueType::BOOL: return value.asBool() ? "true" : "false";
+            case ValueType::NUMBER: return formatNumber(value.asNumber());
+            case ValueType::OBJECT: break;
+        }
+
+        switch (value.asObject()->getObjectType())
+        {
+            case ObjectType::STRING:
+                return value.asString()->chars;
+            case ObjectType::VM_FUNCTION:
+                return fmt::format("<fn {}>", as<ObjFunction>(value)->name->chars);
+            case ObjectType::VM_CLOSURE:
+                return fmt::format("<fn {}>", as<ObjClosure>(value)->function->name->chars);
+            case ObjectType::VM_BOUND_METHOD:
+                return fmt::format("<fn {}>", as<ObjBoundMethod>(value)->method->function->name->chars);
+            case ObjectType::VM_NATIVE:
+                return "<native fn>";
+            case ObjectType::VM_CLASS:
+                return fmt::format("<cl {}>", as<ObjClass>(value)->name->chars);
+            case ObjectType::VM_INSTANCE:
+                return as<ObjInstance>(value)->klass->name->chars + " instance";
+            default:
+                return "";
+        }
+    }
+}
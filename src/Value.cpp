@@ -0,0 +1,49 @@
+#include "Value.h"
+
+#include <ostream>
+
+#include <fmt/format.h>
+
+namespace Lox
+{
+    std::string_view formatNumber(double number, char (&buffer)[NUMBER_BUFFER_SIZE])
+    {
+        // fmt picks the shortest round-trip form; the longest, like
+        // -1.7976931348623157e+308, is well within the buffer.
+        auto result = fmt::format_to_n(buffer, NUMBER_BUFFER_SIZE, "{}", number);
+        return std::string_view(buffer, result.size);
+    }
+
+    std::string formatNumber(double number)
+    {
+        char buffer[NUMBER_BUFFER_SIZE];
+        return std::string(formatNumber(number, buffer));
+    }
+
+    bool writeValue(std::ostream& out, const Value& value)
+    {
+        if (value.isString())
+        {
+            const std::string& chars = value.asString()->chars;
+            out.write(chars.data(), chars.size());
+            return true;
+        }
+        if (value.isNumber())
+        {
+            char buffer[NUMBER_BUFFER_SIZE];
+            std::string_view text = formatNumber(value.asNumber(), buffer);
+            out.write(text.data(), text.size());
+            return true;
+        }
+        return false;
+    }
+
+    Ref<LoxString> concatenate(const LoxString& a, const LoxString& b)
+    {
+        std::string chars;
+        chars.reserve(a.chars.size() + b.chars.size());
+        chars += a.chars;
+        chars += b.chars;
+        return makeRef<LoxString>(std::move(chars));
+    }
+}
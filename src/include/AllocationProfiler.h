@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Value.h"
+
+namespace Lox
+{
+    // Attributes the runtime objects the tree walking Interpreter creates,
+    // instances, environments, bound methods, strings and so on, to the
+    // source line of the statement that was running and the kind of object.
+    // It counts objects and bytes per line and kind, and follows the bytes
+    // still alive to find their peak.
+    //
+    // An object's bytes are its own size plus the characters of a string too
+    // long for the small string buffer. Objects created before enable() are
+    // not counted.
+    class AllocationProfiler
+    {
+    public:
+        static void enable();
+        // Objects released after this, such as during static destruction,
+        // are ignored.
+        static void stop() { Object::profilingAllocations = false; }
+        static bool isEnabled() { return Object::profilingAllocations; }
+
+        // Called by the Interpreter. A line of 0, for statements the parser
+        // synthesized, keeps the enclosing statement's line.
+        static void enterStatement(int line);
+        static void leaveStatement() { lines.pop_back(); }
+
+        // Lines and kinds sorted by bytes, most first.
+        static void printReport(std::FILE* file);
+
+    private:
+        friend class Object;
+
+        struct Site
+        {
+            std::size_t count = 0;
+            std::size_t bytes = 0;
+        };
+
+        static void allocated(const Object* object, std::size_t bytes);
+        static void released(const Object* object);
+
+        static std::vector<int> lines;
+        static std::map<std::pair<int, ObjectType>, Site> sites;
+        static std::unordered_map<const Object*, std::size_t> live;
+        static std::size_t liveBytes;
+        static std::size_t peakBytes;
+    };
+}
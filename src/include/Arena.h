@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Lox
+{
+    // Bump allocator owning the AST of one compilation unit. Nodes are
+    // carved out of large blocks and freed all at once with the arena, so the
+    // tree links its nodes with plain pointers and visiting a node costs no
+    // reference counting.
+    class Arena
+    {
+    public:
+        Arena() = default;
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+        ~Arena();
+
+        template<typename T, typename... Args>
+        T* make(Args&&... args)
+        {
+            void* memory = allocate(sizeof(T), alignof(T));
+            T* object = new (memory) T(std::forward<Args>(args)...);
+            if constexpr (!std::is_trivially_destructible_v<T>)
+                destructors.push_back({object, [](void* p) { static_cast<T*>(p)->~T(); }});
+            objects++;
+            return object;
+        }
+
+        // How many nodes have been made so far.
+        std::size_t size() const { return objects; }
+
+    private:
+        static constexpr std::size_t BLOCK_SIZE = 64 * 1024;
+
+        struct Destructor
+        {
+            void* object;
+            void (*destroy)(void*);
+        };
+
+        void* allocate(std::size_t size, std::size_t alignment);
+
+        std::vector<std::unique_ptr<std::byte[]>> blocks;
+        std::byte* cursor = nullptr;
+        std::byte* end = nullptr;
+        std::vector<Destructor> destructors;
+        std::size_t objects = 0;
+    };
+}
@@ -12,12 +12,12 @@ namespace Lox
     public:
       //AstPrinter();
 
-      std::any visit_binary_expr(std::shared_ptr<Binary> expr) override;
-      std::any visit_grouping_expr(std::shared_ptr<Grouping> expr) override;
-      std::any visit_literal_expr(std::shared_ptr<Literal> expr) override;
-      std::any visit_unary_expr(std::shared_ptr<Unary> expr) override;
+      std::any visit_binary_expr(Binary* expr) override;
+      std::any visit_grouping_expr(Grouping* expr) override;
+      std::any visit_literal_expr(Literal* expr) override;
+      std::any visit_unary_expr(Unary* expr) override;
 
-      std::string print(std::shared_ptr<Expr> expr);
+      std::string print(Expr* expr);
 
     private:
       std::string paranthesise(const std::string& name, 
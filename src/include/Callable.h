@@ -1,28 +1,30 @@
 #pragma once
 
-#include <any>
 #include <functional>
 #include <memory>
 #include <vector>
 
+#include "Value.h"
+#include "Environment.h"
+
 namespace Lox
 {
     class Interpreter;
     class Function;
-    class Environment;
     class LoxInstance;
 
-    using FuncType = std::function<std::any(Interpreter&, const std::vector<std::any>&)>;
+    using FuncType = std::function<Value(Interpreter&, const std::vector<Value>&)>;
 
-    class Callable 
+    class Callable : public Object
     {
     public:
         //Callable(int arity, FuncType f);
         //Callable(std::shared_ptr<Function> declaration, std::shared_ptr<Environment> closure);
 
         //Callable(const Callable& other);
+        explicit Callable(ObjectType type) : Object(type) {}
 
-        virtual std::any call(Interpreter& interpreter, const std::vector<std::any>& arguments) = 0;
+        virtual Value call(Interpreter& interpreter, const std::vector<Value>& arguments) = 0;
 
         virtual int getArity() = 0;
         //const std::shared_ptr<Function> getDeclaration() const {return declaration;}
@@ -36,17 +38,27 @@ namespace Lox
         int arity = 0;
 
         LoxFunction(int arity, FuncType f);
-        LoxFunction(std::shared_ptr<Function> declaration, std::shared_ptr<Environment> closure, bool isInitializer);
-        std::shared_ptr<LoxFunction> bind(std::shared_ptr<LoxInstance> instance);
-        std::any call(Interpreter& i, const std::vector<std::any>& arguments) override;
+        LoxFunction(Function* declaration, Ref<Environment> closure, bool isInitializer);
+        Ref<LoxFunction> bind(const Ref<LoxInstance>& instance);
+        Value call(Interpreter& i, const std::vector<Value>& arguments) override;
+        // Runs a method with the given instance as "this".
+        Value callMethod(Interpreter& i, const Value& receiver, const std::vector<Value>& arguments);
         int getArity() override;
-        const std::shared_ptr<Function> getDeclaration() const {return declaration;}
+        const Function* getDeclaration() const {return declaration;}
+
+        void trace(Tracer& tracer) const override;
+        void clearReferences() override;
         
 
     private:
-        std::shared_ptr<Function> declaration;
-        std::shared_ptr<Environment> closure;
+        Function* declaration;
+        Ref<Environment> closure;
         bool isInitializer;
+        // The instance a bound method was taken from; nil otherwise.
+        Value receiver;
     };
 
+    inline Callable* Value::asCallable() const { return static_cast<Callable*>(asObject()); }
+    inline LoxFunction* Value::asFunction() const { return static_cast<LoxFunction*>(asObject()); }
+
 }
\ No newline at end of file
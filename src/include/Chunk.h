@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Value.h"
+
+namespace Lox
+{
+    // Every instruction of the bytecode VM. Kept as an X-macro so the opcode
+    // enum and the VM's computed-goto dispatch table can't drift apart.
+    #define LOX_OPCODES(X) \
+        X(CONSTANT)        \
+        X(NIL)             \
+        X(TRUE)            \
+        X(FALSE)           \
+        X(POP)             \
+        X(GET_LOCAL)       \
+        X(SET_LOCAL)       \
+        X(GET_GLOBAL)      \
+        X(DEFINE_GLOBAL)   \
+        X(SET_GLOBAL)      \
+        X(GET_UPVALUE)     \
+        X(SET_UPVALUE)     \
+        X(GET_PROPERTY)    \
+        X(SET_PROPERTY)    \
+        X(GET_SUPER)       \
+        X(EQUAL)           \
+        X(NOT_EQUAL)       \
+        X(GREATER)         \
+        X(GREATER_EQUAL)   \
+        X(LESS)            \
+        X(LESS_EQUAL)      \
+        X(ADD)             \
+        X(SUBTRACT)        \
+        X(MULTIPLY)        \
+        X(DIVIDE)          \
+        X(NOT)             \
+        X(NEGATE)          \
+        X(PRINT)           \
+        X(JUMP)            \
+        X(JUMP_IF_FALSE)   \
+        X(LOOP)            \
+        X(CALL)            \
+        X(INVOKE)          \
+        X(SUPER_INVOKE)    \
+        X(CLOSURE)         \
+        X(CLOSE_UPVALUE)   \
+        X(RETURN)          \
+        X(CLASS)           \
+        X(INHERIT)         \
+        X(METHOD)
+
+    enum class OpCode : std::uint8_t
+    {
+        #define LOX_OPCODE_ENUM(name) name,
+        LOX_OPCODES(LOX_OPCODE_ENUM)
+        #undef LOX_OPCODE_ENUM
+    };
+
+    // A compiled function body: instructions, the source line of every byte
+    // and the constants those instructions refer to. Constant, global and
+    // jump operands are 16 bits wide, slot and argument counts are 8 bits.
+    class Chunk
+    {
+    public:
+        void write(std::uint8_t byte, int line);
+        void write(OpCode op, int line);
+        int addConstant(const Value& value);
+
+        std::vector<std::uint8_t> code;
+        std::vector<int> lines;
+        std::vector<Value> constants;
+    };
+}
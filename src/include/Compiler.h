@@ -0,0 +1,132 @@
+#pragma once
+
+#include <any>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Expr/Expr.h"
+#include "Stmt/Stmt.h"
+#include "Chunk.h"
+#include "VMObjects.h"
+
+namespace Lox
+{
+    class VM;
+
+    // Second pass over the resolved AST that emits bytecode for the VM. Local
+    // variables live in stack slots and variables captured by closures become
+    // upvalues, so the compiler tracks scopes itself instead of using the
+    // Resolver's environment slots.
+    class Compiler : exprVisitor<std::any>, stmtVisitor<std::any>
+    {
+    public:
+        explicit Compiler(VM& vm);
+
+        // Returns the top level script function, or nullptr on a compile error.
+        Ref<ObjFunction> compile(const std::vector<Stmt*>& statements);
+
+    private:
+        enum FunctionType
+        {
+            TYPE_FUNCTION,
+            TYPE_INITIALIZER,
+            TYPE_METHOD,
+            TYPE_SCRIPT
+        };
+
+        struct Local
+        {
+            std::string_view name;
+            int depth;
+            bool isCaptured;
+        };
+
+        struct Upvalue
+        {
+            std::uint8_t index;
+            bool isLocal;
+        };
+
+        struct FunctionState
+        {
+            FunctionState(FunctionState* enclosing, Ref<ObjFunction> function, FunctionType type)
+            : enclosing(enclosing), function(std::move(function)), type(type)
+            {}
+
+            FunctionState* enclosing;
+            Ref<ObjFunction> function;
+            FunctionType type;
+            std::vector<Local> locals;
+            std::vector<Upvalue> upvalues;
+            std::unordered_map<LoxString*, int> identifiers;
+            int scopeDepth = 0;
+        };
+
+        struct ClassState
+        {
+            ClassState* enclosing;
+            bool hasSuperclass;
+        };
+
+        std::any visit_block_stmt(Block* stmt) override;
+        std::any visit_class_stmt(Class* stmt) override;
+        std::any visit_expression_stmt(Expression* stmt) override;
+        std::any visit_function_stmt(Function* stmt) override;
+        std::any visit_if_stmt(If* stmt) override;
+        std::any visit_print_stmt(Print* stmt) override;
+        std::any visit_return_stmt(Return* stmt) override;
+        std::any visit_var_stmt(Var* stmt) override;
+        std::any visit_while_stmt(While* stmt) override;
+
+        std::any visit_assign_expr(Assign* expr) override;
+        std::any visit_literal_expr(Literal* expr) override;
+        std::any visit_logical_expr(Logical* expr) override;
+        std::any visit_set_expr(Set* expr) override;
+        std::any visit_super_expr(Super* expr) override;
+        std::any visit_this_expr(This* expr) override;
+        std::any visit_grouping_expr(Grouping* expr) override;
+        std::any visit_unary_expr(Unary* expr) override;
+        std::any visit_variable_expr(Variable* expr) override;
+        std::any visit_binary_expr(Binary* expr) override;
+        std::any visit_call_expr(Call* expr) override;
+        std::any visit_get_expr(Get* expr) override;
+
+        void compile(Stmt* stmt);
+        void compile(Expr* expr);
+        void function(Function* declaration, FunctionType type);
+
+        void beginScope();
+        void endScope();
+        void declareLocal(const Token& name);
+        void defineVariable(const Token& name);
+        void namedVariable(std::string_view name, bool assign);
+        int resolveLocal(FunctionState& state, std::string_view name);
+        int resolveUpvalue(FunctionState& state, std::string_view name);
+        int addUpvalue(FunctionState& state, std::uint8_t index, bool isLocal);
+
+        Chunk& currentChunk();
+        void emit(std::uint8_t byte);
+        void emit(OpCode op);
+        void emitShort(int value);
+        void emitConstant(const Value& value);
+        void emitReturn();
+        int emitJump(OpCode op);
+        void patchJump(int offset);
+        void emitLoop(int loopStart);
+        int makeConstant(const Value& value);
+        int identifierConstant(std::string_view name);
+        void error(const char* message);
+
+        VM& vm;
+        FunctionState* current = nullptr;
+        ClassState* currentClass = nullptr;
+        // The AST does not carry a line for every node, so instructions are
+        // tagged with the line of the most recently seen token.
+        int line = 1;
+        bool hadError = false;
+    };
+}
@@ -1,31 +1,44 @@
 #pragma once
 
-#include <any>
 #include <string>
+#include <string_view>
 #include <unordered_map>
-#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include "Value.h"
 
 namespace Lox
 {
   class Token;
 
-  class Environment : public std::enable_shared_from_this<Environment>
+  // The global environment (the only one without an enclosing environment)
+  // looks its variables up by name. Every other environment is a flat array
+  // of slots whose indices are handed out by the Resolver in declaration order.
+  class Environment : public Object
   {
     public:
     Environment();
-    Environment(std::shared_ptr<Environment> enclosing);
+    Environment(Ref<Environment> enclosing);
+
+    const Value& get(const Token& name) const;
 
-    const std::any& get(const Token& name) const;
+    const Value& getAt(int distance, int slot);
+    Environment* ancestor(int distance);
 
-    const std::any& getAt(int distance, const std::string& name);
-    std::shared_ptr<Environment> ancestor(int distance);
+    void assign(const Token& name, const Value& value);
+    void assignAt(int distance, int slot, const Value& value);
 
-    void assign(const Token& name, const std::any& value);
-    void assignAt(int distance, const Token& name, std::any& value);
+    void define(std::string_view name, const Value& value);
 
-    void define(const std::string& name, const std::any& value);
+    void trace(Tracer& tracer) const override;
+    void clearReferences() override;
     
-    std::shared_ptr<Environment> enclosing;
-    std::unordered_map<std::string, std::any> values;
+    Ref<Environment> enclosing;
+    // Globals are keyed by views of the names they own, so reading or
+    // writing one looks it up without copying the name.
+    std::unordered_set<std::string> names;
+    std::unordered_map<std::string_view, Value> values;
+    std::vector<Value> slots;
   };
 }
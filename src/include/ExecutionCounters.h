@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Lox
+{
+    struct Function;
+
+    // Exact execution counts for the tree walking Interpreter: how many
+    // times the statements on each source line ran and the time spent in
+    // them, and how many times each Lox function was called and the time
+    // spent inside it.
+    //
+    // A line's time is self time, from when one of its statements starts
+    // until a nested statement starts or it finishes, so the times of all
+    // lines add up to the run time. A function's time includes everything
+    // it calls, and recursive calls are only timed at the outermost call.
+    class ExecutionCounters
+    {
+    public:
+        static void enable();
+        static bool isEnabled() { return enabled; }
+
+        // Called by the Interpreter. A line of 0, for statements the parser
+        // synthesized, is not counted and is timed as the enclosing line.
+        static void enterStatement(int line);
+        static void leaveStatement();
+        static void enterFunction(const Function* declaration);
+        static void leaveFunction(const Function* declaration);
+
+        // Lines and functions sorted by time, hottest first.
+        static void printReport(std::FILE* file);
+        static bool writeJson(const std::string& path);
+
+    private:
+        struct LineStats
+        {
+            std::size_t count = 0;
+            double seconds = 0;
+        };
+
+        struct FunctionStats
+        {
+            std::size_t calls = 0;
+            double seconds = 0;
+            int depth = 0;
+            double start = 0;
+        };
+
+        struct LineEntry
+        {
+            int line;
+            std::size_t count;
+            double seconds;
+        };
+
+        struct FunctionEntry
+        {
+            const Function* declaration;
+            std::size_t calls;
+            double seconds;
+        };
+
+        static std::vector<LineEntry> sortedLines();
+        static std::vector<FunctionEntry> sortedFunctions();
+
+        // Charges the time since the last event to the innermost statement.
+        static void charge(double now);
+
+        static bool enabled;
+        static std::vector<LineStats> lines;
+        static std::vector<int> running;
+        static double lastEvent;
+        static std::unordered_map<const Function*, FunctionStats> functions;
+    };
+}
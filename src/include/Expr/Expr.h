@@ -7,6 +7,8 @@
 #include <vector>
 
 #include "Token.h"
+#include "Value.h"
+#include "Shape.h"
 
 
 namespace Lox
@@ -31,52 +33,69 @@ namespace Lox
   public:
     ~exprVisitor() = default;
     
-    virtual R visit_assign_expr(std::shared_ptr<Assign> expr) = 0;
-    virtual R visit_binary_expr(std::shared_ptr<Binary> expr) = 0;
-    virtual R visit_call_expr(std::shared_ptr<Call> expr) = 0;
-    virtual R visit_get_expr(std::shared_ptr<Get> expr) = 0;
-    virtual R visit_grouping_expr(std::shared_ptr<Grouping> expr) = 0;
-    virtual R visit_literal_expr(std::shared_ptr<Literal> expr) = 0;
-    virtual R visit_logical_expr(std::shared_ptr<Logical> expr) = 0;
-    virtual R visit_set_expr(std::shared_ptr<Set> expr) = 0;
-    virtual R visit_super_expr(std::shared_ptr<Super> expr) = 0;
-    virtual R visit_this_expr(std::shared_ptr<This> expr) = 0;
-    virtual R visit_unary_expr(std::shared_ptr<Unary> expr) = 0;
-    virtual R visit_variable_expr(std::shared_ptr<Variable> expr) = 0;
+    virtual R visit_assign_expr(Assign* expr) = 0;
+    virtual R visit_binary_expr(Binary* expr) = 0;
+    virtual R visit_call_expr(Call* expr) = 0;
+    virtual R visit_get_expr(Get* expr) = 0;
+    virtual R visit_grouping_expr(Grouping* expr) = 0;
+    virtual R visit_literal_expr(Literal* expr) = 0;
+    virtual R visit_logical_expr(Logical* expr) = 0;
+    virtual R visit_set_expr(Set* expr) = 0;
+    virtual R visit_super_expr(Super* expr) = 0;
+    virtual R visit_this_expr(This* expr) = 0;
+    virtual R visit_unary_expr(Unary* expr) = 0;
+    virtual R visit_variable_expr(Variable* expr) = 0;
   };
 
-  struct Expr : public std::enable_shared_from_this<Expr>
+  // Filled in by the Resolver: how many environments up and at which slot a
+  // local variable lives. Globals keep a depth of -1 and are looked up by name.
+  struct ResolvedSlot
+  {
+    int depth = -1;
+    int slot = -1;
+
+    bool isLocal() const { return depth >= 0; }
+  };
+
+  struct Expr
   {
     Expr() = default;
     virtual ~Expr() = default;
 
     virtual std::any accept(exprVisitor<std::any>& visitor) = 0;
+    virtual Value accept(exprVisitor<Value>& visitor) = 0;
   };
 
   struct Assign : public Expr
   {
-    Assign(Token name, std::shared_ptr<Expr> value)
-        : name(name), value(std::move(value))
+    Assign(Token name, Expr* value)
+        : name(name), value(value)
     { 
        assert(this->value != nullptr);
     }
 
     std::any accept(exprVisitor<std::any>& visitor) 
     { 
-      return visitor.visit_assign_expr(std::static_pointer_cast<Assign>(shared_from_this())); 
+      return visitor.visit_assign_expr(this); 
+    }
+
+    Value accept(exprVisitor<Value>& visitor) 
+    { 
+      return visitor.visit_assign_expr(this); 
     }
 
     const Token& getName() const { return name; }
     const Expr& getValue() const { return *value; }
 
     Token name;
-    std::shared_ptr<Expr> value;
+    Expr* value;
+    ResolvedSlot resolved;
   };
 
   struct Binary : public Expr
   {
-    Binary(std::shared_ptr<Expr> left, Token op, std::shared_ptr<Expr> right)
-        : left(std::move(left)), op(op), right(std::move(right))
+    Binary(Expr* left, Token op, Expr* right)
+        : left(left), op(op), right(right)
     { assert(this->left != nullptr);
        
        assert(this->right != nullptr);
@@ -84,22 +103,27 @@ namespace Lox
 
     std::any accept(exprVisitor<std::any>& visitor) 
     { 
-      return visitor.visit_binary_expr(std::static_pointer_cast<Binary>(shared_from_this())); 
+      return visitor.visit_binary_expr(this); 
+    }
+
+    Value accept(exprVisitor<Value>& visitor) 
+    { 
+      return visitor.visit_binary_expr(this); 
     }
 
     const Expr& getLeft() const { return *left; }
     const Token& getOp() const { return op; }
     const Expr& getRight() const { return *right; }
 
-    std::shared_ptr<Expr> left;
+    Expr* left;
     Token op;
-    std::shared_ptr<Expr> right;
+    Expr* right;
   };
 
   struct Call : public Expr
   {
-    Call(std::shared_ptr<Expr> callee, Token paren, std::vector<std::shared_ptr<Expr>> arguments)
-        : callee(std::move(callee)), paren(paren), arguments(std::move(arguments))
+    Call(Expr* callee, Token paren, std::vector<Expr*> arguments)
+        : callee(callee), paren(paren), arguments(std::move(arguments))
     { assert(this->callee != nullptr);
        
        
@@ -107,74 +131,98 @@ namespace Lox
 
     std::any accept(exprVisitor<std::any>& visitor) 
     { 
-      return visitor.visit_call_expr(std::static_pointer_cast<Call>(shared_from_this())); 
+      return visitor.visit_call_expr(this); 
+    }
+
+    Value accept(exprVisitor<Value>& visitor) 
+    { 
+      return visitor.visit_call_expr(this); 
     }
 
     const Expr& getCallee() const { return *callee; }
     const Token& getParen() const { return paren; }
-    const std::vector<std::shared_ptr<Expr>>& getArguments() const { return arguments; }
+    const std::vector<Expr*>& getArguments() const { return arguments; }
 
-    std::shared_ptr<Expr> callee;
+    Expr* callee;
     Token paren;
-    std::vector<std::shared_ptr<Expr>> arguments;
+    std::vector<Expr*> arguments;
+    // Set by the Parser when the callee is a Get, so obj.method(args) can
+    // call the method without creating a bound method first.
+    Get* method = nullptr;
   };
   struct Get : public Expr
   {
-    Get(std::shared_ptr<Expr> object, Token name)
-        : object(std::move(object)), name(name)
+    Get(Expr* object, Token name)
+        : object(object), name(name)
     { assert(this->object != nullptr);
        
     }
 
     std::any accept(exprVisitor<std::any>& visitor) 
     { 
-      return visitor.visit_get_expr(std::static_pointer_cast<Get>(shared_from_this())); 
+      return visitor.visit_get_expr(this); 
+    }
+
+    Value accept(exprVisitor<Value>& visitor) 
+    { 
+      return visitor.visit_get_expr(this); 
     }
 
     const Expr& getObject() const { return *object; }
     const Token& getName() const { return name; }
 
-    std::shared_ptr<Expr> object;
+    Expr* object;
     Token name;
+    InlineCache cache;
   };
   struct Grouping : public Expr
   {
-    Grouping(std::shared_ptr<Expr> expr)
-        : expr(std::move(expr))
+    Grouping(Expr* expr)
+        : expr(expr)
     { assert(this->expr != nullptr);
     }
 
     std::any accept(exprVisitor<std::any>& visitor) 
     { 
-      return visitor.visit_grouping_expr(std::static_pointer_cast<Grouping>(shared_from_this())); 
+      return visitor.visit_grouping_expr(this); 
+    }
+
+    Value accept(exprVisitor<Value>& visitor) 
+    { 
+      return visitor.visit_grouping_expr(this); 
     }
 
     const Expr& getExpr() const { return *expr; }
 
-    std::shared_ptr<Expr> expr;
+    Expr* expr;
   };
 
   struct Literal : public Expr
   {
-    Literal(std::any literal)
-        : literal(literal)
+    Literal(Value literal)
+        : literal(std::move(literal))
     { 
     }
 
     std::any accept(exprVisitor<std::any>& visitor) 
     { 
-      return visitor.visit_literal_expr(std::static_pointer_cast<Literal>(shared_from_this())); 
+      return visitor.visit_literal_expr(this); 
+    }
+
+    Value accept(exprVisitor<Value>& visitor) 
+    { 
+      return visitor.visit_literal_expr(this); 
     }
 
-    const std::any& getLiteral() const { return literal; }
+    const Value& getLiteral() const { return literal; }
 
-    std::any literal;
+    Value literal;
   };
 
   struct Logical : public Expr
   {
-    Logical(std::shared_ptr<Expr> left, Token op, std::shared_ptr<Expr> right)
-        : left(std::move(left)), op(op), right(std::move(right))
+    Logical(Expr* left, Token op, Expr* right)
+        : left(left), op(op), right(right)
     { assert(this->left != nullptr);
        
        assert(this->right != nullptr);
@@ -182,21 +230,26 @@ namespace Lox
 
     std::any accept(exprVisitor<std::any>& visitor) 
     { 
-      return visitor.visit_logical_expr(std::static_pointer_cast<Logical>(shared_from_this())); 
+      return visitor.visit_logical_expr(this); 
+    }
+
+    Value accept(exprVisitor<Value>& visitor) 
+    { 
+      return visitor.visit_logical_expr(this); 
     }
 
     const Expr& getLeft() const { return *left; }
     const Token& getOp() const { return op; }
     const Expr& getRight() const { return *right; }
 
-    std::shared_ptr<Expr> left;
+    Expr* left;
     Token op;
-    std::shared_ptr<Expr> right;
+    Expr* right;
   };
   struct Set : public Expr
   {
-    Set(std::shared_ptr<Expr> object, Token name, std::shared_ptr<Expr> value)
-        : object(std::move(object)), name(name), value(std::move(value))
+    Set(Expr* object, Token name, Expr* value)
+        : object(object), name(name), value(value)
     { assert(this->object != nullptr);
        
        assert(this->value != nullptr);
@@ -204,16 +257,22 @@ namespace Lox
 
     std::any accept(exprVisitor<std::any>& visitor) 
     { 
-      return visitor.visit_set_expr(std::static_pointer_cast<Set>(shared_from_this())); 
+      return visitor.visit_set_expr(this); 
+    }
+
+    Value accept(exprVisitor<Value>& visitor) 
+    { 
+      return visitor.visit_set_expr(this); 
     }
 
     const Expr& getObject() const { return *object; }
     const Token& getName() const { return name; }
     const Expr& getValue() const { return *value; }
 
-    std::shared_ptr<Expr> object;
+    Expr* object;
     Token name;
-    std::shared_ptr<Expr> value;
+    Expr* value;
+    InlineCache cache;
   };
 
   struct Super : public Expr
@@ -226,13 +285,19 @@ namespace Lox
 
     std::any accept(exprVisitor<std::any>& visitor)
     {
-      return visitor.visit_super_expr(std::static_pointer_cast<Super>(shared_from_this()));
+      return visitor.visit_super_expr(this);
+    }
+
+    Value accept(exprVisitor<Value>& visitor) 
+    { 
+      return visitor.visit_super_expr(this); 
     }
     const Token& getKeyword() const { return keyword; }
     const Token& getMethod() const { return keyword; }
 
     Token keyword;
     Token method;
+    ResolvedSlot resolved;
   };
 
   struct This : public Expr
@@ -244,32 +309,43 @@ namespace Lox
 
     std::any accept(exprVisitor<std::any>& visitor) 
     { 
-      return visitor.visit_this_expr(std::static_pointer_cast<This>(shared_from_this())); 
+      return visitor.visit_this_expr(this); 
+    }
+
+    Value accept(exprVisitor<Value>& visitor) 
+    { 
+      return visitor.visit_this_expr(this); 
     }
 
     const Token& getKeyword() const { return keyword; }
 
     Token keyword;
+    ResolvedSlot resolved;
   };
 
   struct Unary : public Expr
   {
-    Unary(Token op, std::shared_ptr<Expr> right)
-        : op(op), right(std::move(right))
+    Unary(Token op, Expr* right)
+        : op(op), right(right)
     { 
        assert(this->right != nullptr);
     }
 
     std::any accept(exprVisitor<std::any>& visitor) 
     { 
-      return visitor.visit_unary_expr(std::static_pointer_cast<Unary>(shared_from_this())); 
+      return visitor.visit_unary_expr(this); 
+    }
+
+    Value accept(exprVisitor<Value>& visitor) 
+    { 
+      return visitor.visit_unary_expr(this); 
     }
 
     const Token& getOp() const { return op; }
     const Expr& getRight() const { return *right; }
 
     Token op;
-    std::shared_ptr<Expr> right;
+    Expr* right;
   };
 
   struct Variable : public Expr
@@ -281,12 +357,18 @@ namespace Lox
 
     std::any accept(exprVisitor<std::any>& visitor) 
     { 
-      return visitor.visit_variable_expr(std::static_pointer_cast<Variable>(shared_from_this())); 
+      return visitor.visit_variable_expr(this); 
+    }
+
+    Value accept(exprVisitor<Value>& visitor) 
+    { 
+      return visitor.visit_variable_expr(this); 
     }
 
     const Token& getName() const { return name; }
 
     Token name;
+    ResolvedSlot resolved;
   };
 
 }
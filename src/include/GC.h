@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Value.h"
+
+namespace Lox
+{
+    // Cycle collector for runtime objects. Reference counting frees most
+    // objects as soon as the last reference goes away, but a cycle, such as
+    // a function stored in the environment it closes over, keeps its own
+    // counts above zero forever.
+    //
+    // collect() is a mark-sweep pass over every tracked object. Its roots
+    // are the objects referenced from outside the tracked heap: the
+    // interpreter's globals, current environment and return value, the VM
+    // stack, and any Value a C++ frame is holding. Each object's count
+    // minus the references traced from other tracked objects gives its
+    // outside references, so no frame has to register its temporaries.
+    // Whatever cannot be reached from a root is garbage, and clearing its
+    // references lets the counts drop to zero.
+    class GC
+    {
+    public:
+        struct Stats
+        {
+            std::size_t collections = 0;
+            std::size_t objectsFreed = 0;
+            std::size_t liveObjects = 0;
+            std::size_t peakObjects = 0;
+            double milliseconds = 0;
+        };
+
+        static void collect();
+
+        // Called by both engines between steps, where no object is still
+        // under construction. Collects once the heap has roughly doubled
+        // since the last collection.
+        static void collectIfNeeded()
+        {
+            if (allocations >= threshold)
+                collect();
+        }
+
+        static const Stats& getStats() { return stats; }
+        static void printStats();
+
+    private:
+        friend class Object;
+
+        static constexpr std::size_t MIN_THRESHOLD = 4096;
+
+        static Object* objects;
+        static std::size_t allocations;
+        static std::size_t threshold;
+        static Stats stats;
+    };
+}
@@ -9,80 +9,121 @@
 #include "Expr/Expr.h"
 #include "Stmt/Stmt.h"
 #include "RuntimeError.h"
-#include "ReturnException.h"
 #include "Callable.h"
+#include "OutputBuffering.h"
 
 
 namespace Lox
 {
-    class Interpreter : exprVisitor<std::any>, stmtVisitor<std::any>
+    struct TimingStats;
+
+    class Interpreter : exprVisitor<Value>, stmtVisitor<ExecStatus>
     {
     public:
         Interpreter(std::ostream& out);
         ~Interpreter();
-        void interpret(const std::vector<std::shared_ptr<Stmt>>& statements);
+        void interpret(const std::vector<Stmt*>& statements);
 
         Environment& getGlobalsEnvironment();
 
-        void execute(std::shared_ptr<Stmt> stmt);
-        void executeBlock(const std::vector<std::shared_ptr<Stmt>>& statements, 
-            std::shared_ptr<Environment> environment);
-          
-        void resolve(const std::shared_ptr<Expr>& expr, int depth);
-        std::any lookUpVariable(const Token& name, std::shared_ptr<Expr> expr);
+        void setOutputBuffering(OutputBuffering buffering) { this->buffering = buffering; }
+
+        // Turns on the hooks the Profiler, ExecutionCounters,
+        // AllocationProfiler and TraceEvents need. When
+        // off, each statement and call pays for a single branch.
+        void setInstrumented(bool instrumented) { this->instrumented = instrumented; }
+
+        ExecStatus execute(Stmt* stmt);
+        ExecStatus executeBlock(const std::vector<Stmt*>& statements, 
+            Ref<Environment> environment);
+
+        // The value of the return statement that last finished with
+        // ExecStatus::RETURN, moved out so the slot is left nil.
+        Value takeReturnValue() { return std::move(returnValue); }
+
+        Value lookUpVariable(const Token& name, const ResolvedSlot& resolved);
+
+        // Used by bench(): the stats as an instance of a BenchStats class
+        // made once, so every result shares its shapes.
+        Value makeBenchStats(const TimingStats& stats);
+
+        // Reports a call of a Lox function to the Profiler,
+        // ExecutionCounters and TraceEvents, including one a runtime error
+        // unwinds.
+        class CallGuard
+        {
+        public:
+            CallGuard(Interpreter& i, const Function* declaration);
+            CallGuard(const CallGuard&) = delete;
+            CallGuard& operator=(const CallGuard&) = delete;
+            ~CallGuard();
+
+        private:
+            const Function* declaration;
+            bool active;
+            double start = 0;
+        };
 
     private:
-        std::any visit_block_stmt(std::shared_ptr<Block> stmt) override;
-        std::any visit_class_stmt(std::shared_ptr<Class> stmt) override;
-        std::any visit_expression_stmt(std::shared_ptr<Expression> stmt) override;
-        std::any visit_function_stmt(std::shared_ptr<Function> stmt) override;
-        std::any visit_if_stmt(std::shared_ptr<If> stmt) override;
-        std::any visit_print_stmt(std::shared_ptr<Print> stmt) override;
-        std::any visit_return_stmt(std::shared_ptr<Return> stmt) override;
-        std::any visit_var_stmt(std::shared_ptr<Var> stmt) override;
-        std::any visit_while_stmt(std::shared_ptr<While> stmt) override;
+        ExecStatus visit_block_stmt(Block* stmt) override;
+        ExecStatus visit_class_stmt(Class* stmt) override;
+        ExecStatus visit_expression_stmt(Expression* stmt) override;
+        ExecStatus visit_function_stmt(Function* stmt) override;
+        ExecStatus visit_if_stmt(If* stmt) override;
+        ExecStatus visit_print_stmt(Print* stmt) override;
+        ExecStatus visit_return_stmt(Return* stmt) override;
+        ExecStatus visit_var_stmt(Var* stmt) override;
+        ExecStatus visit_while_stmt(While* stmt) override;
         
-        std::any visit_assign_expr(std::shared_ptr<Assign> expr) override;
-        std::any visit_literal_expr(std::shared_ptr<Literal> expr) override;
-        std::any visit_logical_expr(std::shared_ptr<Logical> expr) override;
-        std::any visit_set_expr(std::shared_ptr<Set> expr) override;
-        std::any visit_super_expr(std::shared_ptr<Super> expr) override;
-        std::any visit_this_expr(std::shared_ptr<This> expr) override;
-        std::any visit_grouping_expr(std::shared_ptr<Grouping> expr) override;
-        std::any visit_unary_expr(std::shared_ptr<Unary> expr) override;
-        std::any visit_variable_expr(std::shared_ptr<Variable> expr) override;
-        std::any visit_binary_expr(std::shared_ptr<Binary> expr) override;
-        std::any visit_call_expr(std::shared_ptr<Call> expr) override;
-        std::any visit_get_expr(std::shared_ptr<Get> expr) override;
+        Value visit_assign_expr(Assign* expr) override;
+        Value visit_literal_expr(Literal* expr) override;
+        Value visit_logical_expr(Logical* expr) override;
+        Value visit_set_expr(Set* expr) override;
+        Value visit_super_expr(Super* expr) override;
+        Value visit_this_expr(This* expr) override;
+        Value visit_grouping_expr(Grouping* expr) override;
+        Value visit_unary_expr(Unary* expr) override;
+        Value visit_variable_expr(Variable* expr) override;
+        Value visit_binary_expr(Binary* expr) override;
+        Value visit_call_expr(Call* expr) override;
+        Value visit_get_expr(Get* expr) override;
         
-        std::string stringify(const std::any& object);
-        std::any evaluate(std::shared_ptr<Expr> expr);
-        bool isTruthy(const std::any& object) const;
-        bool isEqual(const std::any& a, const std::any& b) const;
-        void checkNumberOperand(const Token& op, const std::any& operand) const; 
+        ExecStatus executeInstrumented(Stmt* stmt);
+        std::string stringify(const Value& object);
+        void print(const Value& value);
+        Value evaluate(Expr* expr);
+        Value callValue(const Value& callee, const Call& expr);
+        Value invoke(const Call& expr, Get& get);
+        std::vector<Value> evaluateArguments(const Call& expr);
+        void checkArity(const Token& paren, int arity, std::size_t count) const;
+        bool isTruthy(const Value& object) const;
+        bool isEqual(const Value& a, const Value& b) const;
+        void checkNumberOperand(const Token& op, const Value& operand) const; 
         void checkNumberOperands(const Token& op, 
-            const std::any& left, const std::any& right) const;
+            const Value& left, const Value& right) const;
         
         
         // data
-        std::shared_ptr<Environment> globals;
+        Ref<Environment> globals;
         Environment* globalEnvironment;
-        std::shared_ptr<Environment> environment;
-
-        std::unordered_map<std::shared_ptr<Expr>, int> locals;
+        Ref<Environment> environment;
+        Value returnValue;
+        Ref<LoxClass> benchStatsClass;
 
         class EnterEnvironmentGuard 
         {
         public:
-          EnterEnvironmentGuard(Interpreter& i, std::shared_ptr<Environment> env);
+          EnterEnvironmentGuard(Interpreter& i, Ref<Environment> env);
           ~EnterEnvironmentGuard();
 
         private:
           Interpreter& i;
-          std::shared_ptr<Environment> previous;
+          Ref<Environment> previous;
         };
 
         std::ostream& out;
+        OutputBuffering buffering = OutputBuffering::LINE;
+        bool instrumented = false;
     };
 
 }
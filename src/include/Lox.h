@@ -14,6 +14,7 @@ namespace Lox
       static void Error(int line, const std::string& message);
       static void Error(Token token, const std::string& message);
       static void ReportRuntimeError(const RuntimeError& error);
+      static void ReportRuntimeError(int line, const std::string& message);
 
       static bool HadError;
       static bool HadRuntimeError;
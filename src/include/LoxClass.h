@@ -2,24 +2,41 @@
 
 #include "Callable.h"
 #include "LoxInstance.h"
+#include "Shape.h"
 
 #include <vector>
 #include <unordered_map>
 #include <string>
+#include <string_view>
 
 namespace Lox
 {
-    class LoxClass : public Callable, public std::enable_shared_from_this<LoxClass> 
+    class LoxClass : public Callable
     {
     public:
-        LoxClass(const std::string& name, std::shared_ptr<LoxClass> superclass, std::unordered_map<std::string, std::shared_ptr<LoxFunction>> methods);
-        std::shared_ptr<LoxFunction> findMethod(const std::string& name) const;
-        std::any call(Interpreter& interpreter, const std::vector<std::any>& arguments) override;
+        LoxClass(std::string_view name, Ref<LoxClass> superclass, std::unordered_map<std::string_view, Ref<LoxFunction>> methods);
+        LoxFunction* findMethod(std::string_view name) const;
+        Value call(Interpreter& interpreter, const std::vector<Value>& arguments) override;
         int getArity() override;
 
+        void trace(Tracer& tracer) const override;
+        void clearReferences() override;
+
         std::string toString();
         std::string name;
-        std::shared_ptr<LoxClass> superclass;
-        std::unordered_map<std::string, std::shared_ptr<LoxFunction>> methods;
+        Ref<LoxClass> superclass;
+        // Includes the inherited methods, so lookups never walk the
+        // superclass chain. Keyed by the names in the source, which
+        // outlives every class.
+        std::unordered_map<std::string_view, Ref<LoxFunction>> methods;
+        // Shape of a fresh instance; every instance keeps its class alive
+        // and with it the shape tree.
+        Shape rootShape;
+
+    private:
+        LoxFunction* initializer = nullptr;
+        int arity = 0;
     };
+
+    inline LoxClass* Value::asClass() const { return static_cast<LoxClass*>(asObject()); }
 }
\ No newline at end of file
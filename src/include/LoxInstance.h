@@ -1,27 +1,51 @@
 #pragma once
 
 #include "Token.h"
+#include "Value.h"
+#include "Shape.h"
 
-#include <unordered_map>
-#include <any>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace Lox
 {
     class LoxClass;
+    class LoxFunction;
 
-    class LoxInstance : public std::enable_shared_from_this<LoxInstance>
+    class LoxInstance : public Object
     {
     public:
-        LoxInstance(const std::shared_ptr<LoxClass>& klass);
+        // What a property name resolves to: a field, or failing that one of
+        // the class's methods. Both are null if the instance has neither.
+        struct Property
+        {
+            const Value* field = nullptr;
+            LoxFunction* method = nullptr;
+        };
 
-        std::any get(const Token& name);
-        void set(Token& name, std::any& value);
+        LoxInstance(const Ref<LoxClass>& klass);
+
+        // The cache belongs to the Get or Set node doing the access. On a hit
+        // the field is read or written by index, or the method is returned,
+        // without hashing the name.
+        Value get(const Token& name, InlineCache& cache);
+        // Like get() but leaves binding the method to the caller.
+        Property findProperty(const Token& name, InlineCache& cache);
+        void set(const Token& name, const Value& value, InlineCache& cache);
+
+        LoxClass* getClass() const { return klass.get(); }
+
+        void trace(Tracer& tracer) const override;
+        // Keeps the class, which owns the shape this instance points at.
+        void clearReferences() override;
 
         std::string toString() ;
     private:
-        std::shared_ptr<LoxClass> klass;
-        std::unordered_map<std::string, std::any> fields;
+        Ref<LoxClass> klass;
+        Shape* shape;
+        std::vector<Value> fields;
     };
+
+    inline LoxInstance* Value::asInstance() const { return static_cast<LoxInstance*>(asObject()); }
 }
\ No newline at end of file
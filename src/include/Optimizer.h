@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+#include "Expr/Expr.h"
+#include "Stmt/Stmt.h"
+#include "Arena.h"
+
+namespace Lox
+{
+    // Pass over the resolved AST that both engines run. It folds operators
+    // whose operands are all literals into a single Literal, drops
+    // parentheses, and removes if branches and while loops whose condition is
+    // a literal that means they never run. Operations that would fail at
+    // runtime, like adding a string to a number, are left alone so the error
+    // is still reported when the code runs.
+    class Optimizer : exprVisitor<std::any>, stmtVisitor<std::any>
+    {
+    public:
+        // Replacement nodes are allocated from the arena of the tree.
+        explicit Optimizer(Arena& arena);
+
+        void optimize(std::vector<Stmt*>& statements);
+
+    private:
+        std::any visit_block_stmt(Block* stmt) override;
+        std::any visit_class_stmt(Class* stmt) override;
+        std::any visit_expression_stmt(Expression* stmt) override;
+        std::any visit_function_stmt(Function* stmt) override;
+        std::any visit_if_stmt(If* stmt) override;
+        std::any visit_print_stmt(Print* stmt) override;
+        std::any visit_return_stmt(Return* stmt) override;
+        std::any visit_var_stmt(Var* stmt) override;
+        std::any visit_while_stmt(While* stmt) override;
+
+        std::any visit_assign_expr(Assign* expr) override;
+        std::any visit_literal_expr(Literal* expr) override;
+        std::any visit_logical_expr(Logical* expr) override;
+        std::any visit_set_expr(Set* expr) override;
+        std::any visit_super_expr(Super* expr) override;
+        std::any visit_this_expr(This* expr) override;
+        std::any visit_grouping_expr(Grouping* expr) override;
+        std::any visit_unary_expr(Unary* expr) override;
+        std::any visit_variable_expr(Variable* expr) override;
+        std::any visit_binary_expr(Binary* expr) override;
+        std::any visit_call_expr(Call* expr) override;
+        std::any visit_get_expr(Get* expr) override;
+
+        // Returns the node to use in place of the given one; statements that
+        // can never run come back as nullptr.
+        Stmt* optimize(Stmt* stmt);
+        Expr* optimize(Expr* expr);
+        // For places that need a statement even if it was removed.
+        Stmt* optimizeBranch(Stmt* stmt);
+
+        Arena& arena;
+    };
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+namespace Lox
+{
+    // When the engines flush what print statements write. LINE flushes every
+    // line, which keeps a terminal up to date. BLOCK leaves the output in the
+    // stream's buffer until it fills, a runtime error is reported, or the
+    // program finishes running.
+    enum class OutputBuffering
+    {
+        LINE,
+        BLOCK
+    };
+}
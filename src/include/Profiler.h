@@ -0,0 +1,67 @@
+#pragma once
+
+#include <csignal>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Lox
+{
+    // Sampling profiler for the tree walking Interpreter. While it runs, a
+    // CPU time timer ticks at the requested frequency and the signal handler
+    // only counts the tick. The Interpreter polls that count as it starts
+    // each statement and leaves each function, and records its logical call
+    // stack, the Lox functions being run and the line each one is at, once
+    // per pending tick.
+    //
+    // Samples are written as collapsed stacks, one "frame;frame;frame count"
+    // line per distinct stack, which flamegraph.pl, inferno and speedscope
+    // read directly.
+    class Profiler
+    {
+    public:
+        // Returns false if the platform has no profiling timer.
+        static bool start(int frequency);
+        static void stop();
+        static bool write(const std::string& path);
+
+        static bool isRunning() { return running; }
+
+        // Called by the Interpreter while running. A line of 0 keeps the
+        // line the frame was at, for statements the parser synthesized.
+        static void enter(std::string_view function, int line);
+        static void leave()
+        {
+            poll();
+            stack.pop_back();
+        }
+        static void step(int line)
+        {
+            poll();
+            if (line != 0)
+                stack.back().line = line;
+        }
+
+    private:
+        struct Frame
+        {
+            std::string_view function;
+            int line;
+        };
+
+        static void poll()
+        {
+            if (ticks != 0)
+                sample();
+        }
+        static void sample();
+        static void onTick(int);
+
+        static bool running;
+        static volatile std::sig_atomic_t ticks;
+        static std::vector<Frame> stack;
+        static std::unordered_map<std::string, std::size_t> samples;
+    };
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+
+namespace Lox
+{
+    // What --stats prints when the program exits. The counters are bumped
+    // unconditionally where the work happens; an increment costs less than
+    // checking whether anyone will read it. Both engines count calls,
+    // instances and bound methods; only the tree walking Interpreter has
+    // environments and return statements that unwind.
+    struct RunStats
+    {
+        double scanSeconds = 0;
+        double parseSeconds = 0;
+        double resolveSeconds = 0;
+        double optimizeSeconds = 0;
+        double interpretSeconds = 0;
+
+        std::size_t tokens = 0;
+        std::size_t astNodes = 0;
+        std::size_t calls = 0;
+        std::size_t environments = 0;
+        std::size_t instances = 0;
+        std::size_t boundMethods = 0;
+        // Return statements run. They unwind with ExecStatus::RETURN rather
+        // than by throwing, so no return costs an exception.
+        std::size_t returns = 0;
+
+        static RunStats current;
+
+        // The environment and return counts are left out for the VM.
+        void print(std::FILE* file, bool treeWalker) const;
+    };
+}
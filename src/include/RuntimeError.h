@@ -17,4 +17,11 @@ namespace Lox
     private:
         Token token;
     };
+
+    // Thrown by native functions, which have no token to report an error
+    // at; the call turns it into a RuntimeError at its closing parenthesis.
+    class NativeError : public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+    };
 }
\ No newline at end of file
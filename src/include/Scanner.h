@@ -1,9 +1,7 @@
 #pragma once
 
-#include <any>
 #include <vector>
-#include <unordered_map>
-#include <string>
+#include <string_view>
 
 #include "Token.h"
 #include "TokenType.h"
@@ -13,14 +11,15 @@ namespace Lox
   class Scanner 
   {
     public:
-      Scanner(std::string source);
+      // The scanner only views the source, see Token.
+      explicit Scanner(std::string_view source);
       std::vector<Token> scanTokens();
 
     private:
       bool isAtEnd() const;
       char advance();
       void addToken(TokenType type);
-      void addToken(TokenType type, std::any literal);
+      void addToken(TokenType type, TokenLiteral literal);
       void scanToken();
       void string();
       void number();
@@ -28,11 +27,9 @@ namespace Lox
       bool match(char expected);
       char peek() const;
       char peekNext() const;
-      std::string source;
+      std::string_view source;
       std::vector<Token> tokens;
 
-      std::unordered_map<std::string, TokenType> keywords;
-
       int start = 0;
       int current = 0;
       int line = 1;
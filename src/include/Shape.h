@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+
+namespace Lox
+{
+    class LoxFunction;
+
+    // Hidden class shared by every instance that got the same fields added in
+    // the same order. It maps field names to indices into the instance's
+    // field array. Adding a field moves the instance along a transition to a
+    // child shape, so shapes form a tree rooted at the class's empty shape.
+    // Field names are views of the source, which outlives every class.
+    class Shape
+    {
+    public:
+        Shape();
+
+        // Index of the field in instances of this shape, or -1.
+        int lookup(std::string_view name) const;
+        // The shape an instance of this shape moves to when it gains a field.
+        Shape* withField(std::string_view name);
+
+        // Unique for the lifetime of the program, unlike the shape's address,
+        // so inline caches can hold on to it without keeping the shape alive.
+        std::uint32_t getId() const { return id; }
+        int fieldCount() const { return static_cast<int>(slots.size()); }
+
+    private:
+        std::uint32_t id;
+        std::unordered_map<std::string_view, int> slots;
+        std::unordered_map<std::string_view, std::unique_ptr<Shape>> transitions;
+    };
+
+    // Per-site cache kept on Get and Set nodes: the last few shapes seen at
+    // the site and where the field lives in them. A Set that adds a field
+    // also records the shape the instance transitions to. A Get that finds
+    // no field records the method it found instead; a shape only belongs to
+    // one class, so the method cannot change under it.
+    struct InlineCache
+    {
+        static constexpr int SIZE = 4;
+
+        struct Entry
+        {
+            std::uint32_t shape = 0;
+            int slot = -1;
+            Shape* transition = nullptr;
+            LoxFunction* method = nullptr;
+        };
+
+        const Entry* find(std::uint32_t shape) const
+        {
+            for (int i = 0; i < count; ++i)
+                if (entries[i].shape == shape)
+                    return &entries[i];
+            return nullptr;
+        }
+
+        // Once full the site is megamorphic and further shapes are looked up
+        // without being cached.
+        void add(const Entry& entry)
+        {
+            if (count < SIZE)
+                entries[count++] = entry;
+        }
+
+        Entry entries[SIZE];
+        int count = 0;
+    };
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace Lox
+{
+    // Read-only source text handed to the Scanner. A script file is mapped
+    // into memory where the platform allows it and read whole otherwise;
+    // REPL lines just own their string. Tokens view the text, so it has to
+    // stay alive as long as the AST built from it.
+    class SourceFile
+    {
+    public:
+        SourceFile() = default;
+        explicit SourceFile(std::string text);
+        SourceFile(const SourceFile&) = delete;
+        SourceFile& operator=(const SourceFile&) = delete;
+        ~SourceFile();
+
+        // Returns false if the file can't be opened or read.
+        bool open(const std::string& path);
+
+        std::string_view text() const { return view; }
+
+    private:
+        bool map(const std::string& path);
+        bool read(const std::string& path);
+
+        std::string buffer;
+        void* mapping = nullptr;
+        std::size_t mappingSize = 0;
+        std::string_view view;
+    };
+}
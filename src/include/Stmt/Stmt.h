@@ -29,84 +29,113 @@ namespace Lox
   public:
     ~stmtVisitor() = default;
     
-    virtual R visit_block_stmt(std::shared_ptr<Block> stmt) = 0;
-    virtual R visit_class_stmt(std::shared_ptr<Class> stmt) = 0;
-    virtual R visit_expression_stmt(std::shared_ptr<Expression> stmt) = 0;
-    virtual R visit_function_stmt(std::shared_ptr<Function> stmt) = 0;
-    virtual R visit_if_stmt(std::shared_ptr<If> stmt) = 0;
-    virtual R visit_print_stmt(std::shared_ptr<Print> stmt) = 0;
-    virtual R visit_return_stmt(std::shared_ptr<Return> stmt) = 0;
-    virtual R visit_var_stmt(std::shared_ptr<Var> stmt) = 0;
-    virtual R visit_while_stmt(std::shared_ptr<While> stmt) = 0;
+    virtual R visit_block_stmt(Block* stmt) = 0;
+    virtual R visit_class_stmt(Class* stmt) = 0;
+    virtual R visit_expression_stmt(Expression* stmt) = 0;
+    virtual R visit_function_stmt(Function* stmt) = 0;
+    virtual R visit_if_stmt(If* stmt) = 0;
+    virtual R visit_print_stmt(Print* stmt) = 0;
+    virtual R visit_return_stmt(Return* stmt) = 0;
+    virtual R visit_var_stmt(Var* stmt) = 0;
+    virtual R visit_while_stmt(While* stmt) = 0;
   };
 
-  struct Stmt : public std::enable_shared_from_this<Stmt>
+  // How a statement finished running in the Interpreter. A RETURN unwinds
+  // through the enclosing blocks and loops up to the function call, which
+  // picks up the returned value from the Interpreter.
+  enum class ExecStatus
+  {
+    NORMAL,
+    RETURN
+  };
+
+  struct Stmt
   {
     Stmt() = default;
     virtual ~Stmt() = default;
 
     virtual std::any accept(stmtVisitor<std::any>& visitor) = 0;
+    virtual ExecStatus accept(stmtVisitor<ExecStatus>& visitor) = 0;
+
+    // The line the statement starts on, set by the Parser. Statements it
+    // synthesizes while desugaring leave it 0.
+    int line = 0;
   };
 
   struct Block : public Stmt
   {
-    Block(std::vector<std::shared_ptr<Stmt>> stmt)
+    Block(std::vector<Stmt*> stmt)
         : stmt(std::move(stmt))
     { 
     }
 
     std::any accept(stmtVisitor<std::any>& visitor) 
     { 
-      return visitor.visit_block_stmt(std::static_pointer_cast<Block>(shared_from_this())); 
+      return visitor.visit_block_stmt(this); 
     }
 
-    const std::vector<std::shared_ptr<Stmt>>& getStmt() const { return stmt; }
+    ExecStatus accept(stmtVisitor<ExecStatus>& visitor) 
+    { 
+      return visitor.visit_block_stmt(this); 
+    }
 
-    std::vector<std::shared_ptr<Stmt>> stmt;
+    const std::vector<Stmt*>& getStmt() const { return stmt; }
+
+    std::vector<Stmt*> stmt;
   };
 
   struct Class : public Stmt
   {
-    Class(Token name, std::shared_ptr<Variable> superclass, std::vector<std::shared_ptr<Function>> methods)
-        : name(name), superclass(std::move(superclass)), methods(std::move(methods))
+    Class(Token name, Variable* superclass, std::vector<Function*> methods)
+        : name(name), superclass(superclass), methods(std::move(methods))
     { 
        
     }
 
     std::any accept(stmtVisitor<std::any>& visitor) 
     { 
-      return visitor.visit_class_stmt(std::static_pointer_cast<Class>(shared_from_this())); 
+      return visitor.visit_class_stmt(this); 
+    }
+
+    ExecStatus accept(stmtVisitor<ExecStatus>& visitor) 
+    { 
+      return visitor.visit_class_stmt(this); 
     }
 
     const Token& getName() const { return name; }
-    const std::shared_ptr<Variable>& getSuperClass() const { return superclass; }
-    const std::vector<std::shared_ptr<Function>>& getMethods() const { return methods; }
+    const Variable* getSuperClass() const { return superclass; }
+    const std::vector<Function*>& getMethods() const { return methods; }
 
     Token name;
-    std::shared_ptr<Variable> superclass;
-    std::vector<std::shared_ptr<Function>> methods;
+    Variable* superclass;
+    std::vector<Function*> methods;
   };
 
   struct Expression : public Stmt
   {
-    Expression(std::shared_ptr<Expr> expr)
-        : expr(std::move(expr))
+    Expression(Expr* expr)
+        : expr(expr)
     { assert(this->expr != nullptr);
     }
 
     std::any accept(stmtVisitor<std::any>& visitor) 
     { 
-      return visitor.visit_expression_stmt(std::static_pointer_cast<Expression>(shared_from_this())); 
+      return visitor.visit_expression_stmt(this); 
+    }
+
+    ExecStatus accept(stmtVisitor<ExecStatus>& visitor) 
+    { 
+      return visitor.visit_expression_stmt(this); 
     }
 
     const Expr& getExpr() const { return *expr; }
 
-    std::shared_ptr<Expr> expr;
+    Expr* expr;
   };
 
   struct Function : public Stmt
   {
-    Function(Token name, std::vector<Token> params, std::vector<std::shared_ptr<Stmt>> body)
+    Function(Token name, std::vector<Token> params, std::vector<Stmt*> body)
         : name(name), params(params), body(body)
     { 
       assert(name.getType() == TokenType::IDENTIFIER); 
@@ -115,113 +144,143 @@ namespace Lox
 
     std::any accept(stmtVisitor<std::any>& visitor) 
     { 
-      return visitor.visit_function_stmt(std::static_pointer_cast<Function>(shared_from_this())); 
+      return visitor.visit_function_stmt(this); 
+    }
+
+    ExecStatus accept(stmtVisitor<ExecStatus>& visitor) 
+    { 
+      return visitor.visit_function_stmt(this); 
     }
 
     const Token& getName() const { return name; }
     const std::vector<Token>& getParams() const { return params; }
-    const std::vector<std::shared_ptr<Stmt>>& getBody() const { return body; }
+    const std::vector<Stmt*>& getBody() const { return body; }
 
     Token name;
     std::vector<Token> params;
-    std::vector<std::shared_ptr<Stmt>> body;
+    std::vector<Stmt*> body;
   };
 
   struct If : public Stmt
   {
-    If(std::shared_ptr<Expr> condition, std::shared_ptr<Stmt> thenBranch, std::shared_ptr<Stmt> elseBranch)
-        : condition(std::move(condition)), thenBranch(std::move(thenBranch)), elseBranch(std::move(elseBranch))
+    If(Expr* condition, Stmt* thenBranch, Stmt* elseBranch)
+        : condition(condition), thenBranch(thenBranch), elseBranch(elseBranch)
     { assert(this->condition != nullptr);
        assert(this->thenBranch != nullptr);
     }
 
     std::any accept(stmtVisitor<std::any>& visitor) 
     { 
-      return visitor.visit_if_stmt(std::static_pointer_cast<If>(shared_from_this())); 
+      return visitor.visit_if_stmt(this); 
+    }
+
+    ExecStatus accept(stmtVisitor<ExecStatus>& visitor) 
+    { 
+      return visitor.visit_if_stmt(this); 
     }
 
     const Expr& getCondition() const { return *condition; }
     const Stmt& getThenbranch() const { return *thenBranch; }
     const Stmt& getElsebranch() const { return *elseBranch; }
 
-    std::shared_ptr<Expr> condition;
-    std::shared_ptr<Stmt> thenBranch;
-    std::shared_ptr<Stmt> elseBranch;
+    Expr* condition;
+    Stmt* thenBranch;
+    Stmt* elseBranch;
   };
 
   struct Print : public Stmt
   {
-    Print(std::shared_ptr<Expr> expr)
-        : expr(std::move(expr))
+    Print(Expr* expr)
+        : expr(expr)
     { assert(this->expr != nullptr);
     }
 
     std::any accept(stmtVisitor<std::any>& visitor) 
     { 
-      return visitor.visit_print_stmt(std::static_pointer_cast<Print>(shared_from_this())); 
+      return visitor.visit_print_stmt(this); 
+    }
+
+    ExecStatus accept(stmtVisitor<ExecStatus>& visitor) 
+    { 
+      return visitor.visit_print_stmt(this); 
     }
 
     const Expr& getExpr() const { return *expr; }
 
-    std::shared_ptr<Expr> expr;
+    Expr* expr;
   };
 
   struct Return : public Stmt
   {
-    Return(Token keyword, std::shared_ptr<Expr> value)
-        : keyword(keyword), value(std::move(value))
+    Return(Token keyword, Expr* value)
+        : keyword(keyword), value(value)
     { 
     }
 
     std::any accept(stmtVisitor<std::any>& visitor) 
     { 
-      return visitor.visit_return_stmt(std::static_pointer_cast<Return>(shared_from_this())); 
+      return visitor.visit_return_stmt(this); 
+    }
+
+    ExecStatus accept(stmtVisitor<ExecStatus>& visitor) 
+    { 
+      return visitor.visit_return_stmt(this); 
     }
 
     const Token& getKeyword() const { return keyword; }
     const Expr& getValue() const { return *value; }
 
     Token keyword;
-    std::shared_ptr<Expr> value;
+    Expr* value;
   };
 
   struct Var : public Stmt
   {
-    Var(Token name, std::shared_ptr<Expr> initializer)
-        : name(name), initializer(std::move(initializer))
+    Var(Token name, Expr* initializer)
+        : name(name), initializer(initializer)
     { 
     }
 
     std::any accept(stmtVisitor<std::any>& visitor) 
     { 
-      return visitor.visit_var_stmt(std::static_pointer_cast<Var>(shared_from_this())); 
+      return visitor.visit_var_stmt(this); 
+    }
+
+    ExecStatus accept(stmtVisitor<ExecStatus>& visitor) 
+    { 
+      return visitor.visit_var_stmt(this); 
     }
 
     const Token& getName() const { return name; }
     const Expr& getInitializer() const { return *initializer; }
 
     Token name;
-    std::shared_ptr<Expr> initializer;
+    Expr* initializer;
   };
 
   struct While : public Stmt
   {
-    While(std::shared_ptr<Expr> condition, std::shared_ptr<Stmt> body)
-        : condition(std::move(condition)), body(std::move(body))
+    While(Expr* condition, Stmt* body)
+        : condition(condition), body(body)
     { assert(this->condition != nullptr);
        assert(this->body != nullptr);
     }
 
     std::any accept(stmtVisitor<std::any>& visitor) 
     { 
-      return visitor.visit_while_stmt(std::static_pointer_cast<While>(shared_from_this())); 
+      return visitor.visit_while_stmt(this); 
+    }
+
+    ExecStatus accept(stmtVisitor<ExecStatus>& visitor) 
+    { 
+      return visitor.visit_while_stmt(this); 
     }
 
     const Expr& getCondition() const { return *condition; }
     const Stmt& getBody() const { return *body; }
 
-    std::shared_ptr<Expr> condition;
-    std::shared_ptr<Stmt> body;
+    Expr* condition;
+    Stmt* body;
   };
 
 }
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+
+namespace Lox
+{
+    // Time on a monotonic clock, counted from when the program started so
+    // even nanoseconds stay exact in a double. Backs the clock() and
+    // clockNanos() natives of both engines.
+    double clockSeconds();
+    double clockNanos();
+
+    // Nearest-rank percentile of sorted values, for p from 0 to 100. There
+    // has to be at least one value.
+    double percentile(const std::vector<double>& sorted, double p);
+
+    // bench() takes a whole number of iterations up to this, which keeps
+    // its samples under 80 MB.
+    constexpr double MAX_BENCH_ITERATIONS = 1e7;
+    bool isValidBenchIterations(double iterations);
+
+    // What the bench() native returns, in seconds per iteration.
+    struct TimingStats
+    {
+        double iterations;
+        double total;
+        double mean;
+        double min;
+        double median;
+        double p95;
+        double max;
+
+        // Sorts the samples. There has to be at least one.
+        static TimingStats summarize(std::vector<double>& samples);
+
+        // Field names in the order forEachField() visits them.
+        template<typename F>
+        void forEachField(F f) const
+        {
+            f("iterations", iterations);
+            f("total", total);
+            f("mean", mean);
+            f("min", min);
+            f("median", median);
+            f("p95", p95);
+            f("max", max);
+        }
+    };
+}
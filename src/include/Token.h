@@ -1,21 +1,29 @@
 #pragma once
 
-#include <any>
 #include <string>
+#include <string_view>
+#include <variant>
 
 #include <TokenType.h>
 
 namespace Lox
 {
+  // The value of a NUMBER or STRING token. Strings are a view of the source
+  // between the quotes.
+  using TokenLiteral = std::variant<std::monostate, double, std::string_view>;
+
+  // Tokens do not copy their text: the lexeme is a view into the source they
+  // were scanned from, which has to outlive every token and AST node built
+  // from it.
   class Token
   {
     public:
-      Token(TokenType type, std::string lexeme, std::any literal, int line);
-      Token(TokenType type, std::string lexeme, int line);
+      Token(TokenType type, std::string_view lexeme, TokenLiteral literal, int line);
+      Token(TokenType type, std::string_view lexeme, int line);
       std::string toString() const;
       std::string literalToString() const;
-      std::string lexeme;
-      std::any literal;
+      std::string_view lexeme;
+      TokenLiteral literal;
       TokenType getType() const;
       int getLine() const;
     private:
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+namespace Lox
+{
+    // Writes a Chrome trace_event JSON file, which chrome://tracing and
+    // Perfetto show as a timeline. Each event is a complete ("X") event with
+    // its start and duration in microseconds since the program started, so
+    // it is written once it has finished.
+    class TraceEvents
+    {
+    public:
+        // Returns false if the file can't be created.
+        static bool open(const std::string& path);
+        // Writes the end of the file.
+        static void close();
+        static bool isOpen() { return file != nullptr; }
+
+        // Calls of Lox functions that take less than this are not recorded.
+        static void setCallThreshold(double microseconds) { callThreshold = microseconds; }
+        static double getCallThreshold() { return callThreshold; }
+
+        // Times are in microseconds, from now().
+        static double now();
+        static void complete(std::string_view name, const char* category, double start, double end, int line = 0);
+
+    private:
+        static std::FILE* file;
+        static bool first;
+        static double callThreshold;
+    };
+
+    // Records the time until it goes out of scope as one event, when a trace
+    // is being written.
+    class TraceSpan
+    {
+    public:
+        explicit TraceSpan(const char* name, const char* category = "phase")
+        : name(name), category(category), start(TraceEvents::isOpen() ? TraceEvents::now() : 0)
+        {}
+        TraceSpan(const TraceSpan&) = delete;
+        TraceSpan& operator=(const TraceSpan&) = delete;
+        ~TraceSpan()
+        {
+            if (TraceEvents::isOpen())
+                TraceEvents::complete(name, category, start, TraceEvents::now());
+        }
+
+    private:
+        const char* name;
+        const char* category;
+        double start;
+    };
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Stmt/Stmt.h"
+#include "VMObjects.h"
+#include "OutputBuffering.h"
+
+namespace Lox
+{
+    struct TimingStats;
+
+    // Stack based virtual machine executing the bytecode produced by the
+    // Compiler. It is an alternative to the tree walking Interpreter and
+    // keeps its globals between calls to interpret() so it can back the REPL.
+    class VM
+    {
+    public:
+        explicit VM(std::ostream& out);
+        ~VM();
+
+        void interpret(const std::vector<Stmt*>& statements);
+
+        void setOutputBuffering(OutputBuffering buffering) { this->buffering = buffering; }
+
+        // Used by the Compiler: identifiers are interned so property and
+        // method lookups can key on the string's address, and every global
+        // name is given a fixed slot in the globals array.
+        Ref<LoxString> intern(std::string_view chars);
+        int globalSlot(std::string_view name);
+
+        // Used by natives: calls a value with no arguments and runs it to
+        // completion, leaving what it returned in result. On a runtime error,
+        // which has already been reported, returns false.
+        bool callFromNative(const Value& callee, Value& result);
+        void runtimeError(const std::string& message);
+        // The stats as an instance of a BenchStats class made once.
+        Value makeBenchStats(const TimingStats& stats);
+
+    private:
+        static constexpr int FRAMES_MAX = 1024;
+        static constexpr int STACK_MAX = FRAMES_MAX * 256;
+
+        struct CallFrame
+        {
+            ObjClosure* closure;
+            const std::uint8_t* ip;
+            Value* slots;
+        };
+
+        struct Global
+        {
+            Value value;
+            bool defined;
+        };
+
+        // Runs until the frame count drops back to baseFrame.
+        bool run(int baseFrame = 0);
+        bool call(ObjClosure* closure, int argCount);
+        bool callValue(const Value& callee, int argCount);
+        bool invoke(LoxString* name, int argCount);
+        bool invokeFromClass(ObjClass* klass, LoxString* name, int argCount);
+        bool bindMethod(ObjClass* klass, LoxString* name);
+        Ref<ObjUpvalue> captureUpvalue(Value* local);
+        void closeUpvalues(Value* last);
+        void defineMethod(LoxString* name);
+        void defineNative(const std::string& name, NativeFn function, int arity);
+
+        void push(Value value) { *stackTop++ = std::move(value); }
+        Value pop() { return std::move(*--stackTop); }
+        const Value& peek(int distance) const { return stackTop[-1 - distance]; }
+        void resetStack();
+        std::string stringify(const Value& value) const;
+        void print(const Value& value);
+
+        std::unique_ptr<Value[]> stack;
+        Value* stackTop;
+        CallFrame frames[FRAMES_MAX];
+        int frameCount = 0;
+
+        std::vector<Global> globals;
+        std::vector<std::string> globalNames;
+        std::unordered_map<std::string, int> globalSlots;
+        std::unordered_map<std::string, Ref<LoxString>> strings;
+        Ref<ObjUpvalue> openUpvalues;
+        LoxString* initString;
+        Ref<ObjClass> benchStatsClass;
+
+        std::ostream& out;
+        OutputBuffering buffering = OutputBuffering::LINE;
+    };
+}
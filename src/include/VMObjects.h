@@ -0,0 +1,162 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+#include "Chunk.h"
+#include "Value.h"
+
+namespace Lox
+{
+    // A function compiled to bytecode. It is only ever called through an
+    // ObjClosure, which carries the captured variables.
+    class ObjFunction : public Object
+    {
+    public:
+        ObjFunction() : Object(ObjectType::VM_FUNCTION) {}
+
+        void trace(Tracer& tracer) const override
+        {
+            for (const Value& constant : chunk.constants)
+                tracer.visit(constant);
+        }
+        void clearReferences() override { chunk.constants.clear(); }
+
+        int arity = 0;
+        int upvalueCount = 0;
+        Chunk chunk;
+        Ref<LoxString> name;
+    };
+
+    class VM;
+
+    // Natives get the VM so they can call back into Lox code. They store
+    // what they return in result, or report a runtime error through the VM
+    // and return false.
+    using NativeFn = bool (*)(VM& vm, int argCount, Value* args, Value& result);
+
+    class ObjNative : public Object
+    {
+    public:
+        ObjNative(NativeFn function, int arity)
+        : Object(ObjectType::VM_NATIVE), function(function), arity(arity)
+        {}
+
+        NativeFn function;
+        int arity;
+    };
+
+    // A captured variable. While the variable is still on the VM stack the
+    // upvalue is "open" and points at the stack slot; when the slot goes away
+    // the value is moved into `closed` and `location` points there instead.
+    class ObjUpvalue : public Object
+    {
+    public:
+        explicit ObjUpvalue(Value* slot)
+        : Object(ObjectType::VM_UPVALUE), location(slot)
+        {}
+
+        // An open upvalue's stack slot is owned by the VM, not the upvalue.
+        void trace(Tracer& tracer) const override
+        {
+            tracer.visit(closed);
+            tracer.visit(next);
+        }
+        void clearReferences() override
+        {
+            closed = Value{};
+            next = nullptr;
+        }
+
+        Value* location;
+        Value closed;
+        Ref<ObjUpvalue> next;
+    };
+
+    class ObjClosure : public Object
+    {
+    public:
+        explicit ObjClosure(Ref<ObjFunction> function)
+        : Object(ObjectType::VM_CLOSURE), function(std::move(function))
+        {
+            upvalues.resize(this->function->upvalueCount);
+        }
+
+        void trace(Tracer& tracer) const override
+        {
+            tracer.visit(function);
+            for (const Ref<ObjUpvalue>& upvalue : upvalues)
+                tracer.visit(upvalue);
+        }
+        void clearReferences() override { upvalues.clear(); }
+
+        Ref<ObjFunction> function;
+        std::vector<Ref<ObjUpvalue>> upvalues;
+    };
+
+    // Method and field names are interned by the VM, so they are keyed by
+    // pointer rather than by string contents.
+    class ObjClass : public Object
+    {
+    public:
+        explicit ObjClass(Ref<LoxString> name)
+        : Object(ObjectType::VM_CLASS), name(std::move(name))
+        {}
+
+        void trace(Tracer& tracer) const override
+        {
+            for (const auto& [name, method] : methods)
+                tracer.visit(method);
+        }
+        void clearReferences() override
+        {
+            methods.clear();
+            initializer = nullptr;
+        }
+
+        Ref<LoxString> name;
+        std::unordered_map<LoxString*, Ref<ObjClosure>> methods;
+        ObjClosure* initializer = nullptr;
+    };
+
+    class ObjInstance : public Object
+    {
+    public:
+        explicit ObjInstance(Ref<ObjClass> klass)
+        : Object(ObjectType::VM_INSTANCE), klass(std::move(klass))
+        {}
+
+        void trace(Tracer& tracer) const override
+        {
+            tracer.visit(klass);
+            for (const auto& [name, field] : fields)
+                tracer.visit(field);
+        }
+        void clearReferences() override { fields.clear(); }
+
+        Ref<ObjClass> klass;
+        std::unordered_map<LoxString*, Value> fields;
+    };
+
+    class ObjBoundMethod : public Object
+    {
+    public:
+        ObjBoundMethod(Value receiver, Ref<ObjClosure> method)
+        : Object(ObjectType::VM_BOUND_METHOD), receiver(std::move(receiver)), method(std::move(method))
+        {}
+
+        void trace(Tracer& tracer) const override
+        {
+            tracer.visit(receiver);
+            tracer.visit(method);
+        }
+        void clearReferences() override
+        {
+            receiver = Value{};
+            method = nullptr;
+        }
+
+        Value receiver;
+        Ref<ObjClosure> method;
+    };
+}
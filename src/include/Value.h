@@ -0,0 +1,291 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace Lox
+{
+    enum class ObjectType : std::uint8_t
+    {
+        STRING,
+        FUNCTION,
+        CLASS,
+        INSTANCE,
+        // Objects only the bytecode VM creates, see VMObjects.h.
+        VM_FUNCTION,
+        VM_NATIVE,
+        VM_CLOSURE,
+        VM_UPVALUE,
+        VM_CLASS,
+        VM_INSTANCE,
+        VM_BOUND_METHOD,
+        ENVIRONMENT
+    };
+
+    class Tracer;
+
+    // Base of every heap allocated runtime value. Objects are reference
+    // counted intrusively (and non-atomically) so a Value only needs to carry
+    // a raw pointer instead of a shared_ptr control block. Objects that can
+    // refer to other objects are also tracked by the cycle collector (GC.h),
+    // which frees the reference cycles counting alone never reclaims.
+    class Object
+    {
+    public:
+        explicit Object(ObjectType type) : objectType(type)
+        {
+            if (type != ObjectType::STRING && type != ObjectType::VM_NATIVE)
+                track();
+        }
+        Object(const Object&) = delete;
+        Object& operator=(const Object&) = delete;
+        virtual ~Object()
+        {
+            if (tracked)
+                untrack();
+            if (profiled)
+                profileRelease();
+        }
+
+        ObjectType getObjectType() const { return objectType; }
+
+        // Reports every Object this one holds a counted reference to.
+        virtual void trace(Tracer& /*tracer*/) const {}
+        // Drops those references; the collector calls this to break up
+        // garbage cycles.
+        virtual void clearReferences() {}
+
+        // Set while the allocation profiler (AllocationProfiler.h) runs;
+        // makeRef() then reports each object it creates.
+        static bool profilingAllocations;
+        void profileAllocation(std::size_t size);
+
+        void retain() { ++refCount; }
+        void release()
+        {
+            if (--refCount == 0)
+                delete this;
+        }
+
+    private:
+        friend class GC;
+
+        void track();
+        void untrack();
+        void profileRelease();
+
+        ObjectType objectType;
+        bool tracked = false;
+        bool marked = false;
+        bool profiled = false;
+        std::uint32_t refCount = 0;
+        // Collector bookkeeping: the list of tracked objects and the count of
+        // references from outside the tracked heap.
+        Object* gcPrev = nullptr;
+        Object* gcNext = nullptr;
+        std::int64_t gcRefs = 0;
+    };
+
+    // Owning pointer to an Object subclass.
+    template<typename T>
+    class Ref
+    {
+    public:
+        Ref() = default;
+        Ref(std::nullptr_t) {}
+        Ref(T* ptr) : ptr(ptr) { if (ptr) ptr->retain(); }
+        Ref(const Ref& other) : Ref(other.ptr) {}
+        Ref(Ref&& other) noexcept : ptr(std::exchange(other.ptr, nullptr)) {}
+        template<typename U>
+        Ref(const Ref<U>& other) : Ref(other.get()) {}
+        ~Ref() { if (ptr) ptr->release(); }
+
+        Ref& operator=(Ref other) noexcept
+        {
+            std::swap(ptr, other.ptr);
+            return *this;
+        }
+
+        T* get() const { return ptr; }
+        T* operator->() const { return ptr; }
+        T& operator*() const { return *ptr; }
+        explicit operator bool() const { return ptr != nullptr; }
+
+        bool operator==(const Ref& other) const { return ptr == other.ptr; }
+        bool operator!=(const Ref& other) const { return ptr != other.ptr; }
+        bool operator==(std::nullptr_t) const { return ptr == nullptr; }
+        bool operator!=(std::nullptr_t) const { return ptr != nullptr; }
+
+    private:
+        T* ptr = nullptr;
+    };
+
+    template<typename T, typename... Args>
+    Ref<T> makeRef(Args&&... args)
+    {
+        T* object = new T(std::forward<Args>(args)...);
+        if (Object::profilingAllocations)
+            object->profileAllocation(sizeof(T));
+        return Ref<T>(object);
+    }
+
+    class LoxString : public Object
+    {
+    public:
+        explicit LoxString(std::string chars)
+        : Object(ObjectType::STRING), chars(std::move(chars))
+        {}
+
+        std::string chars;
+    };
+
+    class Callable;
+    class LoxFunction;
+    class LoxClass;
+    class LoxInstance;
+
+    enum class ValueType : std::uint8_t
+    {
+        NIL,
+        BOOL,
+        NUMBER,
+        OBJECT
+    };
+
+    // A runtime value: nil, booleans and numbers are stored inline, everything
+    // else is a counted pointer to an Object.
+    class Value
+    {
+    public:
+        Value() : type(ValueType::NIL) { as.number = 0; }
+        Value(bool boolean) : type(ValueType::BOOL) { as.number = 0; as.boolean = boolean; }
+        Value(double number) : type(ValueType::NUMBER) { as.number = number; }
+        Value(Object* object) : type(object ? ValueType::OBJECT : ValueType::NIL)
+        {
+            as.object = object;
+            if (object) object->retain();
+        }
+        template<typename T>
+        Value(const Ref<T>& object) : Value(static_cast<Object*>(object.get())) {}
+        Value(const char*) = delete;
+
+        Value(const Value& other) : type(other.type), as(other.as)
+        {
+            if (isObject()) as.object->retain();
+        }
+        Value(Value&& other) noexcept : type(other.type), as(other.as)
+        {
+            other.type = ValueType::NIL;
+        }
+        ~Value()
+        {
+            if (isObject()) as.object->release();
+        }
+
+        Value& operator=(Value other) noexcept
+        {
+            std::swap(type, other.type);
+            std::swap(as, other.as);
+            return *this;
+        }
+
+        ValueType getType() const { return type; }
+        bool isNil() const { return type == ValueType::NIL; }
+        bool isBool() const { return type == ValueType::BOOL; }
+        bool isNumber() const { return type == ValueType::NUMBER; }
+        bool isObject() const { return type == ValueType::OBJECT; }
+        bool isObjectType(ObjectType objectType) const
+        {
+            return isObject() && as.object->getObjectType() == objectType;
+        }
+        bool isString() const { return isObjectType(ObjectType::STRING); }
+        bool isFunction() const { return isObjectType(ObjectType::FUNCTION); }
+        bool isClass() const { return isObjectType(ObjectType::CLASS); }
+        bool isInstance() const { return isObjectType(ObjectType::INSTANCE); }
+        bool isCallable() const { return isFunction() || isClass(); }
+
+        bool asBool() const { return as.boolean; }
+        double asNumber() const { return as.number; }
+        Object* asObject() const { return as.object; }
+        LoxString* asString() const { return static_cast<LoxString*>(as.object); }
+        // Defined in Callable.h, LoxClass.h and LoxInstance.h.
+        inline Callable* asCallable() const;
+        inline LoxFunction* asFunction() const;
+        inline LoxClass* asClass() const;
+        inline LoxInstance* asInstance() const;
+
+        bool isTruthy() const
+        {
+            if (isNil()) return false;
+            if (isBool()) return as.boolean;
+            return true;
+        }
+
+        bool operator==(const Value& other) const
+        {
+            if (type != other.type) return false;
+            switch (type)
+            {
+                case ValueType::NIL: return true;
+                case ValueType::BOOL: return as.boolean == other.as.boolean;
+                case ValueType::NUMBER: return as.number == other.as.number;
+                case ValueType::OBJECT:
+                    if (isString() && other.isString())
+                        return asString()->chars == other.asString()->chars;
+                    return as.object == other.as.object;
+            }
+            return false;
+        }
+        bool operator!=(const Value& other) const { return !(*this == other); }
+
+    private:
+        ValueType type;
+        union
+        {
+            bool boolean;
+            double number;
+            Object* object;
+        } as;
+    };
+
+    static_assert(sizeof(Value) == 16, "Value should stay two words wide");
+
+    // Passed to Object::trace() by the collector.
+    class Tracer
+    {
+    public:
+        virtual ~Tracer() = default;
+        virtual void visit(Object* object) = 0;
+
+        void visit(const Value& value)
+        {
+            if (value.isObject())
+                visit(value.asObject());
+        }
+        template<typename T>
+        void visit(const Ref<T>& object)
+        {
+            if (object)
+                visit(static_cast<Object*>(object.get()));
+        }
+    };
+
+    // How both engines print a number: the shortest text that reads back as
+    // the same double, without a fraction for integers. The first overload
+    // writes into a caller's buffer and returns a view of it.
+    constexpr std::size_t NUMBER_BUFFER_SIZE = 32;
+    std::string_view formatNumber(double number, char (&buffer)[NUMBER_BUFFER_SIZE]);
+    std::string formatNumber(double number);
+
+    // Writes a string or number straight into the stream, without first
+    // building a std::string. Returns false, writing nothing, for any other
+    // value, which each engine stringifies itself.
+    bool writeValue(std::ostream& out, const Value& value);
+
+    // A new string holding a followed by b, allocated once.
+    Ref<LoxString> concatenate(const LoxString& a, const LoxString& b);
+}
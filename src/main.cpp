@@ -1,4 +1,7 @@
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <string>
 #include <fstream>
@@ -9,56 +12,140 @@
 #include "Parser.h"
 #include "Interpreter.h"
 #include "Resolver.h"
+#include "Optimizer.h"
+#include "VM.h"
 #include "AstPrinter.h"
+#include "GC.h"
+#include "Profiler.h"
+#include "ExecutionCounters.h"
+#include "AllocationProfiler.h"
+#include "TraceEvents.h"
+#include "RunStats.h"
+#include "Timing.h"
+#include "SourceFile.h"
+
+#ifdef _WIN32
+#include <io.h>
+#define isatty _isatty
+#define fileno _fileno
+#else
+#include <unistd.h>
+#endif
 
 #define LOX_VERSION "0.0.1"
 
 namespace 
 {
+  enum class Engine
+  {
+    TREE,
+    VM
+  };
+
+  Engine engine = Engine::TREE;
+  bool optimize = true;
+  // Where --profile writes its collapsed stacks, empty when not profiling.
+  std::string profilePath;
+  // --counters prints its report to stderr, --counters=file writes JSON.
+  bool counters = false;
+  std::string countersPath;
+  bool allocProfile = false;
+  // Where --trace writes trace events, empty when not tracing.
+  std::string tracePath;
+
+  // Every chunk of code run so far: its source text and the AST built from
+  // it, whose tokens are views of that text. Functions and classes keep
+  // pointing into the AST after run() returns, so both have to outlive
+  // both engines.
+  struct Unit
+  {
+    Unit() = default;
+    explicit Unit(std::string text) : source(std::move(text)) {}
+
+    Lox::SourceFile source;
+    Lox::Arena arena;
+  };
+
+  std::vector<std::unique_ptr<Unit>> units;
   static Lox::Interpreter interpreter(std::cout);
+
+  // Times one phase of run() for --stats, and records it for --trace.
+  class Phase
+  {
+  public:
+    Phase(const char* name, double& seconds) : span(name), seconds(seconds), start(Lox::clockSeconds()) {}
+    ~Phase() { seconds += Lox::clockSeconds() - start; }
+
+  private:
+    Lox::TraceSpan span;
+    double& seconds;
+    double start;
+  };
+
+  // Only constructed when selected, it preallocates its whole value stack.
+  Lox::VM& vm()
+  {
+    static Lox::VM vm(std::cout);
+    return vm;
+  }
 }
 
-void run(const std::string& source) 
+void run(Unit& unit) 
 {
-  Lox::Scanner scanner(source);
-  Lox::Parser parser(scanner.scanTokens());
-  std::vector<std::shared_ptr<Lox::Stmt>> statements = parser.parse();
+  Lox::RunStats& stats = Lox::RunStats::current;
+  std::vector<Lox::Token> tokens;
+  {
+    Phase phase("scan", stats.scanSeconds);
+    tokens = Lox::Scanner(unit.source.text()).scanTokens();
+  }
+  std::vector<Lox::Stmt*> statements;
+  {
+    Phase phase("parse", stats.parseSeconds);
+    statements = Lox::Parser(std::move(tokens), unit.arena).parse();
+  }
 
   if (Lox::Lox::HadError) {
     return;
   }
-  Lox::Resolver resolver(interpreter);
-  resolver.resolve(statements);
+  {
+    Phase phase("resolve", stats.resolveSeconds);
+    Lox::Resolver resolver;
+    resolver.resolve(statements);
+  }
 
   if (Lox::Lox::HadError)
   {
     return;
   }
+
+  if (optimize) {
+    Phase phase("optimize", stats.optimizeSeconds);
+    Lox::Optimizer(unit.arena).optimize(statements);
+  }
   /*
   std::cout << tokens.size() << std::endl;
   for(auto itr = tokens.begin(); itr != tokens.end(); itr++)
     std::cout << (*itr).toString() << " " << std::endl;
     */
-  interpreter.interpret(statements);
+  Phase phase("interpret", stats.interpretSeconds);
+  if (engine == Engine::VM)
+    vm().interpret(statements);
+  else
+    interpreter.interpret(statements);
 
 }
 
 void runFile(const std::string& path)
 {
-  std::ifstream file{path};
-  if (!file.good()) 
+  Unit& unit = *units.emplace_back(std::make_unique<Unit>());
+  if (!unit.source.open(path)) 
   {
     
     fmt::print("Failed to open {}: No such file or directory\n", path);
     return;
   }
 
-  std::string line;
-  std::string source;
-  while(std::getline(file,line)) {
-    source += line+"\n";
-  }
-  run(source);
+  run(unit);
   if (Lox::Lox::HadError)
     exit(2);
   if(Lox::Lox::HadRuntimeError)
@@ -73,7 +160,7 @@ void runPrompt()
   while(true) {
     fmt::print("> ");
     if(std::getline(std::cin,code)) {
-      run(code);
+      run(*units.emplace_back(std::make_unique<Unit>(code)));
       Lox::Lox::HadError = false;
     } else{
       fmt::print("\n");
@@ -84,11 +171,124 @@ void runPrompt()
 
 int main(int args, char* argv[])
 {
-  if (args>2){
-    fmt::print("usage: lox [script]\n");
+  const char* script = nullptr;
+  bool gcStats = false;
+  bool runStats = false;
+  const char* buffer = "auto";
+  for (int i = 1; i < args; i++) {
+    const std::string arg = argv[i];
+    if (arg == "--engine=tree") {
+      engine = Engine::TREE;
+    } else if (arg == "--engine=vm") {
+      engine = Engine::VM;
+    } else if (arg == "--gc-stats") {
+      gcStats = true;
+    } else if (arg == "--stats") {
+      runStats = true;
+    } else if (arg == "--no-opt") {
+      optimize = false;
+    } else if (arg == "--profile") {
+      profilePath = "lox.folded";
+    } else if (arg.rfind("--profile=", 0) == 0 && arg.size() > 10) {
+      profilePath = arg.substr(10);
+    } else if (arg == "--counters") {
+      counters = true;
+    } else if (arg.rfind("--counters=", 0) == 0 && arg.size() > 11) {
+      counters = true;
+      countersPath = arg.substr(11);
+    } else if (arg == "--alloc-profile") {
+      allocProfile = true;
+    } else if (arg.rfind("--trace=", 0) == 0 && arg.size() > 8) {
+      tracePath = arg.substr(8);
+    } else if (arg.rfind("--trace-threshold=", 0) == 0) {
+      char* end = nullptr;
+      double microseconds = std::strtod(argv[i] + 18, &end);
+      if (end == argv[i] + 18 || *end != '\0' || microseconds < 0) {
+        fmt::print(stderr, "--trace-threshold expects a number of microseconds.\n");
+        exit(1);
+      }
+      Lox::TraceEvents::setCallThreshold(microseconds);
+    } else if (arg == "--buffer=auto" || arg == "--buffer=line" || arg == "--buffer=block") {
+      buffer = argv[i] + 9;
+    } else if (script == nullptr && arg.rfind("--", 0) != 0) {
+      script = argv[i];
+    } else {
+      fmt::print("usage: lox [--engine=tree|vm] [--gc-stats] [--stats] [--no-opt] [--buffer=auto|line|block] [--profile[=file]] [--counters[=file]] [--alloc-profile] [--trace=file] [--trace-threshold=us] [script]\n");
+      exit(1);
+    }
+  }
+  if (!profilePath.empty() && engine == Engine::VM) {
+    fmt::print(stderr, "--profile samples the tree-walking engine only.\n");
+    exit(1);
+  }
+  if (counters && engine == Engine::VM) {
+    fmt::print(stderr, "--counters counts the tree-walking engine only.\n");
+    exit(1);
+  }
+  if (allocProfile && engine == Engine::VM) {
+    fmt::print(stderr, "--alloc-profile attributes the tree-walking engine only.\n");
     exit(1);
-  } else if(args == 2) {
-    runFile(argv[1]);
+  }
+
+  // By default a terminal sees every line as it is printed, while output
+  // going to a file or pipe is written in large blocks.
+  Lox::OutputBuffering buffering = Lox::OutputBuffering::LINE;
+  if (std::strcmp(buffer, "block") == 0 || (std::strcmp(buffer, "auto") == 0 && !isatty(fileno(stdout))))
+    buffering = Lox::OutputBuffering::BLOCK;
+  if (buffering == Lox::OutputBuffering::BLOCK)
+    std::setvbuf(stdout, nullptr, _IOFBF, 64 * 1024);
+  interpreter.setOutputBuffering(buffering);
+  if (engine == Engine::VM)
+    vm().setOutputBuffering(buffering);
+
+  // An exit handler, since runFile() calls exit() directly.
+  if (gcStats)
+    std::atexit([] { Lox::GC::printStats(); });
+  if (runStats)
+    std::atexit([] { Lox::RunStats::current.print(stderr, engine == Engine::TREE); });
+
+  // Samples the Lox call stack about once per millisecond of CPU time.
+  if (!profilePath.empty()) {
+    if (!Lox::Profiler::start(1000)) {
+      fmt::print(stderr, "--profile is not supported on this platform.\n");
+      exit(1);
+    }
+    std::atexit([] {
+      Lox::Profiler::stop();
+      if (Lox::Profiler::write(profilePath))
+        fmt::print(stderr, "[profile] wrote {}\n", profilePath);
+      else
+        fmt::print(stderr, "[profile] failed to write {}\n", profilePath);
+    });
+  }
+
+  if (counters) {
+    Lox::ExecutionCounters::enable();
+    std::atexit([] {
+      if (countersPath.empty())
+        Lox::ExecutionCounters::printReport(stderr);
+      else if (!Lox::ExecutionCounters::writeJson(countersPath))
+        fmt::print(stderr, "[counters] failed to write {}\n", countersPath);
+    });
+  }
+  if (allocProfile) {
+    Lox::AllocationProfiler::enable();
+    std::atexit([] {
+      Lox::AllocationProfiler::printReport(stderr);
+      Lox::AllocationProfiler::stop();
+    });
+  }
+  if (!tracePath.empty()) {
+    if (!Lox::TraceEvents::open(tracePath)) {
+      fmt::print(stderr, "Failed to create {}\n", tracePath);
+      exit(1);
+    }
+    std::atexit([] { Lox::TraceEvents::close(); });
+  }
+  interpreter.setInstrumented(!profilePath.empty() || counters || allocProfile || !tracePath.empty());
+
+  if(script != nullptr) {
+    runFile(script);
   } else  {
     runPrompt();
   }
@@ -3,21 +3,20 @@ import sys
 
 import jinja2
 
-def define_ast(output_dir, base_name, types, includes = []):
+def define_ast(output_dir, base_name, types, includes = [], resolved = [], cached = [], invoked = [], results = []):
     class_specs = []
     type_items = sorted(types.items(), key = lambda x: x[0])
 
     for name, members in type_items:
         arglist = ", ".join(
-            "std::shared_ptr<{}> {}".format(t, n)
+            "{}* {}".format(t, n)
             if i else "{} {}".format(t, n)
             for t, n , i in members)
         initialisers = ", ".join(
-            "{}(std::move({}))".format(n, n)
-            if i else "{}({})".format(n, n)
+            "{}({})".format(n, n)
             for t, n, i in members)
         member_vars = "\n    ".join(
-            "std::shared_ptr<{}> {};". format(t, n)
+            "{}* {};".format(t, n)
             if i else "{} {};".format(t, n)
             for t, n, i in members)
         asserts = "\n       ".join(
@@ -28,11 +27,11 @@ def define_ast(output_dir, base_name, types, includes = []):
             "const %s& get%s() const { return *%s; }" % (t, n.capitalize(), n)
             if i else "const %s& get%s() const { return %s; }" % (t, n.capitalize(), n)
             for t, n, i in members)
-        class_specs.append(dict(name=name, arglist=arglist, initialisers=initialisers, members=member_vars, asserts = asserts, getters = getters))
+        class_specs.append(dict(name=name, arglist=arglist, initialisers=initialisers, members=member_vars, asserts = asserts, getters = getters, resolved = name in resolved, cached = name in cached, invoked = name in invoked))
         with open("ast_template.h") as f:
             template = jinja2.Template(f.read())
         with open(os.path.join(output_dir, "{}.h".format(base_name)), 'w') as f:
-            f.write(template.render(base_name=base_name, class_specs=class_specs, includes=includes))
+            f.write(template.render(base_name=base_name, class_specs=class_specs, includes=includes, results=results))
         
 
 if __name__ == "__main__":
@@ -47,16 +46,25 @@ if __name__ == "__main__":
         "Assign"   : [("Token", "name", False), ("Expr", "value", True)],
         "Binary"   : [("Expr", "left", True), ("Token",  "op", False), 
                       ("Expr", "right", True)],
-        "Call"     : [("Expr", "callee", True), ("Token", "paren", False), ("std::vector<std::shared_ptr<Expr>>", "arguments", False)], 
+        "Call"     : [("Expr", "callee", True), ("Token", "paren", False), ("std::vector<Expr*>", "arguments", False)], 
         #make sure you change the initializer to be std::move 
         "Get"      : [("Expr", "object", True), ("Token", "name", False)],
         "Grouping" : [("Expr", "expr", True)],
-        "Literal"  : [("std::any", "literal", False)],
+        "Literal"  : [("Value", "literal", False)],
         "Logical"  : [("Expr", "left", True), ("Token", "op", False), ("Expr", "right", True)],
         "Set"      : [("Expr", "object", True), ("Token", "name", False), ("Expr", "value", True)],
         "Super"    : [("Token", "keyword", False), ("Token", "method", False)],
         "This"     : [("Token", "keyword", False)],
         "Unary"    : [("Token", "op", False), ("Expr", "right", True)],
         "Variable" : [("Token", "name", False)]
-        }
+        },
+        ["Shape.h"],
+        # nodes the Resolver annotates with a ResolvedSlot
+        resolved = ["Assign", "Super", "This", "Variable"],
+        # property accesses that carry an InlineCache for the Interpreter
+        cached = ["Get", "Set"],
+        # calls that remember a Get callee so methods can be invoked directly
+        invoked = ["Call"],
+        # accept() overloads besides std::any, one per visitor result type
+        results = ["Value"]
     )
@@ -3,21 +3,20 @@ import sys
 
 import jinja2
 
-def define_ast(output_dir, base_name, types, includes = []):
+def define_ast(output_dir, base_name, types, includes = [], results = []):
     class_specs = []
     type_items = sorted(types.items(), key = lambda x: x[0])
 
     for name, members in type_items:
         arglist = ", ".join(
-            "std::shared_ptr<{}> {}".format(t, n)
+            "{}* {}".format(t, n)
             if i else "{} {}".format(t, n)
             for t, n , i in members)
         initialisers = ", ".join(
-            "{}(std::move({}))".format(n, n)
-            if i else "{}({})".format(n, n)
+            "{}({})".format(n, n)
             for t, n, i in members)
         member_vars = "\n    ".join(
-            "std::shared_ptr<{}> {};". format(t, n)
+            "{}* {};".format(t, n)
             if i else "{} {};".format(t, n)
             for t, n, i in members)
         asserts = "\n       ".join(
@@ -32,7 +31,7 @@ def define_ast(output_dir, base_name, types, includes = []):
         with open("ast_template.h") as f:
             template = jinja2.Template(f.read())
         with open(os.path.join(output_dir, "{}.h".format(base_name)), 'w') as f:
-            f.write(template.render(base_name=base_name, class_specs=class_specs, includes=includes))
+            f.write(template.render(base_name=base_name, class_specs=class_specs, includes=includes, results=results))
         
 
 if __name__ == "__main__":
@@ -44,13 +43,13 @@ if __name__ == "__main__":
     define_ast(
         output_dir, "Stmt",
         {
-            "Block"      : [("std::vector<std::shared_ptr<Stmt>>", "stmt", False)], 
+            "Block"      : [("std::vector<Stmt*>", "stmt", False)], 
             #make sure you change the initializer to be std::move 
-            "Class"      : [("Token", "name", False), ("std::shared_ptr<Variable>", "superclass", False) ("std::vector<std::shared_ptr<Function>>", "methods", False)],
+            "Class"      : [("Token", "name", False), ("Variable*", "superclass", False), ("std::vector<Function*>", "methods", False)],
             #make methods and superclass initializer to be std::move
             "Expression" : [("Expr", "expr", True)],
             "Function"   : [("Token", "name", False), ("std::vector<Token>", "params", False), 
-                            ("std::vector<std::shared_ptr<Stmt>>", "body", False)], #Here too (std::move params and body)
+                            ("std::vector<Stmt*>", "body", False)], #Here too (std::move params and body)
             #add assert(name.getType() == TokenType::IDENTIFIER) into the assertations
             "If"         : [("Expr", "condition", True), ("Stmt", "thenBranch", True), ("Stmt", "elseBranch", True)], 
             #Remember that the elseBranch is optional
@@ -61,5 +60,7 @@ if __name__ == "__main__":
             #make sure to remove the assertation for this member variable
             "While"      : [("Expr", "condition", True), ("Stmt", "body", True)]
         },
-        ["Expr/Expr.h"]
+        ["Expr/Expr.h"],
+        # accept() overloads besides std::any, one per visitor result type
+        results = ["ExecStatus"]
     )
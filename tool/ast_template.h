@@ -7,6 +7,7 @@
 #include <vector>
 
 #include "Token.h"
+#include "Value.h"
 {% for inc in includes %}#include "{{ inc }}"
 {% endfor %}
 
@@ -21,15 +22,41 @@ namespace Lox
   public:
     ~{{base_name|lower}}Visitor() = default;
     {% for spec in class_specs %}
-    virtual R visit_{{ spec.name|lower }}_{{ base_name|lower }}(std::shared_ptr<{{ spec.name }}> {{ base_name|lower }}) = 0;{% endfor %}
+    virtual R visit_{{ spec.name|lower }}_{{ base_name|lower }}({{ spec.name }}* {{ base_name|lower }}) = 0;{% endfor %}
   };
 
-  struct {{ base_name }} : public std::enable_shared_from_this<{{ base_name }}>
+{% if base_name == "Expr" %}
+  // Filled in by the Resolver: how many environments up and at which slot a
+  // local variable lives. Globals keep a depth of -1 and are looked up by name.
+  struct ResolvedSlot
   {
-    virtual ~{{ base_name }}() = default;
+    int depth = -1;
+    int slot = -1;
 
-    virtual std::any accept({{ base_name|lower }}Visitor<std::any>& visitor) const = 0;
+    bool isLocal() const { return depth >= 0; }
+  };
+{% endif %}{% if base_name == "Stmt" %}
+  // How a statement finished running in the Interpreter. A RETURN unwinds
+  // through the enclosing blocks and loops up to the function call, which
+  // picks up the returned value from the Interpreter.
+  enum class ExecStatus
+  {
+    NORMAL,
+    RETURN
   };
+{% endif %}
+  struct {{ base_name }}
+  {
+    {{ base_name }}() = default;
+    virtual ~{{ base_name }}() = default;
+
+    virtual std::any accept({{ base_name|lower }}Visitor<std::any>& visitor) = 0;
+{% for result in results %}    virtual {{ result }} accept({{ base_name|lower }}Visitor<{{ result }}>& visitor) = 0;
+{% endfor %}{% if base_name == "Stmt" %}
+    // The line the statement starts on, set by the Parser. Statements it
+    // synthesizes while desugaring leave it 0.
+    int line = 0;
+{% endif %}  };
 {% for spec in class_specs %}
   struct {{ spec.name }} : public {{ base_name }}
   {
@@ -38,14 +65,24 @@ namespace Lox
     { {{ spec.asserts }}
     }
 
-    std::any accept({{ base_name|lower}}Visitor<std::any>& visitor) const
+    std::any accept({{ base_name|lower}}Visitor<std::any>& visitor)
     { 
-      return visitor.visit_{{ spec.name|lower }}_{{ base_name|lower }}(std::static_pointer_cast<{{ spec.name }}>(shared_from_this())); 
+      return visitor.visit_{{ spec.name|lower }}_{{ base_name|lower }}(this); 
     }
-
+{% for result in results %}
+    {{ result }} accept({{ base_name|lower}}Visitor<{{ result }}>& visitor)
+    { 
+      return visitor.visit_{{ spec.name|lower }}_{{ base_name|lower }}(this); 
+    }
+{% endfor %}
     {{ spec.getters }}
 
-    {{ spec.members }}
+    {{ spec.members }}{% if spec.resolved %}
+    ResolvedSlot resolved;{% endif %}{% if spec.cached %}
+    InlineCache cache;{% endif %}{% if spec.invoked %}
+    // Set by the Parser when the callee is a Get, so obj.method(args) can
+    // call the method without creating a bound method first.
+    Get* method = nullptr;{% endif %}
   };
 {% endfor %}
 }